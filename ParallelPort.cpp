@@ -4,6 +4,8 @@
 ///
 ///	$LastChangedDate: 2009-11-27 23:18:55 -0500 (Fri, 27 Nov 2009) $
 ///
+///	Altered for PC-CNC: simulated ports, write tracing and Sleep.
+///
 ///	This library helps you interface and control the parallel port of your
 ///	computer.
 ///
@@ -36,12 +38,27 @@
 
 #include "ParallelPort.h"
 
+#include <cstdio>
+#include <time.h>
+
+
+static unsigned long long Now(void) {
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+};
+
 
 ParallelPort::ParallelPort() {
 	mPortName = "";
 	mPortFD = 0;
 	mPortOpened = false;
 	mDataOut = false;
+	mSimulated = false;
+	mTrace = NULL;
+	mClock = 0;
+	mOpenedAt = 0;
 };
 
 
@@ -77,6 +94,7 @@ void ParallelPort::Open(const std::string& PortName) volatile throw(ParallelPort
 	//Set member variables
 	const_cast<std::string&>(mPortName) = PortName;
 	mPortOpened = true;
+	mOpenedAt = Now();
 
 	//Save existing R/W registers so that we can restore them later
 	mPortSavedRegs[0] = Data();
@@ -89,6 +107,22 @@ void ParallelPort::Open(const std::string& PortName) volatile throw(ParallelPort
 };
 
 
+void ParallelPort::Simulate(const std::string& PortName) volatile throw(ParallelPort_errors) {
+	//Don't open port if it is already opened
+	if (mPortOpened) {
+		throw ParallelPort_errors(Opened);
+	};
+
+	const_cast<std::string&>(mPortName) = PortName;
+	mPortOpened = true;
+	mSimulated = true;
+	mClock = 0;
+	mSimRegs[0] = mSimRegs[1] = mSimRegs[2] = 0;
+	mPortSavedRegs[0] = mPortSavedRegs[1] = 0;
+	mDataOut = true;
+};
+
+
 void ParallelPort::Close(void) volatile throw(ParallelPort_errors) {
 	//Don't close port if its not opened
 	if (!mPortOpened) {
@@ -99,6 +133,15 @@ void ParallelPort::Close(void) volatile throw(ParallelPort_errors) {
 	Data(const_cast<unsigned char&>(mPortSavedRegs[0]));
 	Ctrl(const_cast<unsigned char&>(mPortSavedRegs[1]));
 
+	//A simulated port has no device to release
+	if (mSimulated) {
+		const_cast<std::string&>(mPortName) = "";
+		mPortOpened = false;
+		mSimulated = false;
+		mDataOut = false;
+		return;
+	};
+
 	//Release exlusive use of parallel port
 	if (ioctl(mPortFD, PPRELEASE) < 0) {
 		throw ParallelPort_errors(Perm);
@@ -145,6 +188,10 @@ const unsigned char ParallelPort::Data(void) volatile throw(ParallelPort_errors)
 		throw ParallelPort_errors(Closed);
 	};
 
+	if (mSimulated) {
+		return mSimRegs[0];
+	};
+
 	if (ioctl(mPortFD, PPRDATA, &c)) {
 		throw ParallelPort_errors(Read);
 	};
@@ -159,6 +206,13 @@ void ParallelPort::Data(const unsigned char& c) volatile throw(ParallelPort_erro
 		throw ParallelPort_errors(Closed);
 	};
 
+	Record('D', c);
+
+	if (mSimulated) {
+		mSimRegs[0] = c;
+		return;
+	};
+
 	if (ioctl(mPortFD, PPWDATA, &c)) {
 		throw ParallelPort_errors(Write);
 	};
@@ -189,6 +243,11 @@ void ParallelPort::DataOut(const bool Out) volatile throw(ParallelPort_errors) {
 		PortDataDir = 1;
 	};
 
+	if (mSimulated) {
+		mDataOut = Out;
+		return;
+	};
+
 	if (ioctl(mPortFD, PPDATADIR, &PortDataDir) < 0) {
 		throw ParallelPort_errors(Perm);
 	};
@@ -205,6 +264,10 @@ const unsigned char ParallelPort::Stat(void) volatile throw(ParallelPort_errors)
 		throw ParallelPort_errors(Closed);
 	};
 
+	if (mSimulated) {
+		return mSimRegs[1];
+	};
+
 	if (ioctl(mPortFD, PPRSTATUS, &c)) {
 		throw ParallelPort_errors(Read);
 	};
@@ -221,6 +284,10 @@ const unsigned char ParallelPort::Ctrl(void) volatile throw(ParallelPort_errors)
 		throw ParallelPort_errors(Closed);
 	};
 
+	if (mSimulated) {
+		return mSimRegs[2];
+	};
+
 	if (ioctl(mPortFD, PPRCONTROL, &c)) {
 		throw ParallelPort_errors(Read);
 	};
@@ -235,7 +302,45 @@ void ParallelPort::Ctrl(const unsigned char& c) volatile throw(ParallelPort_erro
 		throw ParallelPort_errors(Closed);
 	};
 
+	Record('C', c);
+
+	if (mSimulated) {
+		mSimRegs[2] = c;
+		return;
+	};
+
 	if (ioctl(mPortFD, PPWCONTROL, &c)) {
 		throw ParallelPort_errors(Write);
 	};
 };
+
+
+bool ParallelPort::IsSimulated(void) volatile {
+	return mSimulated;
+};
+
+
+void ParallelPort::Trace(std::ostream * Out) volatile {
+	mTrace = Out;
+};
+
+
+void ParallelPort::Sleep(unsigned long usec) volatile {
+	if (mSimulated) {
+		mClock += usec;
+	} else {
+		usleep(usec);
+	};
+};
+
+
+void ParallelPort::Record(char Reg, const unsigned char& c) volatile {
+	char	line[40];
+
+	if (!mTrace) {
+		return;
+	};
+
+	snprintf(line, sizeof(line), "%llu %c %02x\n", mSimulated ? mClock : Now() - mOpenedAt, Reg, c);
+	*mTrace << line;
+};
@@ -4,6 +4,8 @@
 ///
 ///	$LastChangedDate: 2009-11-27 23:36:01 -0500 (Fri, 27 Nov 2009) $
 ///
+///	Altered for PC-CNC: simulated ports, write tracing and Sleep.
+///
 ///	This library helps you interface and control the parallel port of your
 ///	computer.
 ///
@@ -38,6 +40,7 @@
 #define __PARALLELPORT_H
 
 #include <string>
+#include <ostream>
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -93,6 +96,14 @@ private:
 	bool	mPortOpened;				///< True if port has been successfully opened and permissions are granted
 	unsigned char	mPortSavedRegs[2];	///< Saved registers which will be restored when port is closed
 	bool	mDataOut;
+	bool	mSimulated;					///< True if port is simulated and no device is used
+	unsigned char	mSimRegs[3];		///< Data, status and control registers of a simulated port
+	std::ostream *	mTrace;				///< Stream that register writes are recorded to, or NULL
+	unsigned long long	mClock;			///< Simulated time in microseconds since the port was opened
+	unsigned long long	mOpenedAt;		///< Monotonic time in microseconds when the port was opened
+
+	///	\brief Records a register write to the trace stream
+	void	Record(char Reg, const unsigned char& c) volatile;
 
 	///	\brief Copy assignment prevention
 	///
@@ -127,6 +138,39 @@ public:
 	///	unsuccessful OS operation
 	void	Open(const std::string& PortName) volatile throw(ParallelPort_errors);
 
+	///	\brief Opens a simulated parallel port
+	///
+	///	Behaves like an opened port without touching any device. Registers
+	///	keep the last written values and Sleep advances a simulated clock
+	///	instead of waiting, so traces taken from it are reproducible.
+	///
+	///	@param[in]		PortName		Name reported for the simulated port
+	///	@exception		ParallelPort_errors		Opened if a port is already
+	///	opened
+	void	Simulate(const std::string& PortName) volatile throw(ParallelPort_errors);
+
+	///	\brief Check to see if port is simulated
+	///
+	///	@return							true if port was opened with Simulate
+	bool	IsSimulated() volatile;
+
+	///	\brief Records register writes
+	///
+	///	Every later write to the data or control register is written to the
+	///	stream as one line holding the time in microseconds since the port
+	///	was opened, the register (D or C) and the value in hexadecimal.
+	///
+	///	@param[in]		Out				Stream to record to, or NULL to stop
+	void	Trace(std::ostream * Out) volatile;
+
+	///	\brief Waits between register writes
+	///
+	///	Sleeps on a real port and advances the simulated clock on a simulated
+	///	one.
+	///
+	///	@param[in]		usec			Microseconds to wait
+	void	Sleep(unsigned long usec) volatile;
+
 	///	\brief Closes opened parallel port
 	///
 	///	Releases exclusive IO handle and closes parallel port so that other
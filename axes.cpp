@@ -0,0 +1,105 @@
+#include "axes.h"
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+
+Axes::Axes(deque<Stepper> & steppers) : _steppers(steppers){
+	_count = steppers.size();
+	if (_count > AXES_MAX){
+		cerr << "Only " << AXES_MAX << " steppers can move together" << endl;
+		_count = AXES_MAX;
+	}
+	_ticks = 0;
+	_delay = 0;
+	_mask = 0;
+	for(int i = 0; i < AXES_MAX; i++){
+		unsigned mask = i < _count ? steppers[i].Mask() : 0;
+		_pos[i] = _target[i] = i < _count ? steppers[i].getPos() : 0;
+		_motor[i] = i < _count ? steppers[i].getMotor() : 0;
+		_last[i] = i < _count ? steppers[i].getDir() : 1;
+		_least[i] = i < _count and steppers[i].getMaxSpeed() > 0 ? (unsigned long) ceill(minute / (steppers[i].getMaxSpeed() * steppers[i].getSteps())) : 0;
+		_err[i] = _inc[i] = _dir[i] = _slack[i] = _taken[i] = 0;
+		_phase[i] = _motor[i] & 3;
+		_low[i] = mask & (~mask + 1);
+		_high[i] = mask & ~_low[i];
+		_mask |= mask;
+	}
+}
+// Sets up a move to target and returns the number of ticks it takes, or -1
+// leaving the axes as they were if that is more than AXES_TICKS.
+long Axes::Plan(const long * target){
+	long inc[AXES_MAX], slack[AXES_MAX], ticks = 0;
+	unsigned long delay = 0;
+	int dir[AXES_MAX];
+	for(int i = 0; i < _count; i++){
+		Stepper & s = _steppers[i];
+		long d = target[i] - _pos[i];
+		dir[i] = d < 0 ? -1 : d > 0 ? 1 : _last[i];
+		slack[i] = dir[i] != _last[i] ? s.getBacklash() : 0;
+		inc[i] = labs(target[i] + s.Screw(target[i]) - _pos[i] - s.Screw(_pos[i]));
+		if (inc[i] + slack[i] > ticks)
+			ticks = inc[i] + slack[i];
+		if (inc[i] + slack[i] and _least[i] > delay)
+			delay = _least[i];
+	}
+	if (ticks > AXES_TICKS)
+		return -1;
+	_ticks = ticks;
+	_delay = delay;
+	for(int i = 0; i < _count; i++){
+		_target[i] = target[i];
+		_dir[i] = dir[i];
+		_slack[i] = slack[i];
+		_inc[i] = inc[i];
+	}
+	for(int i = 0; i < AXES_MAX; i++){
+		_err[i] = _ticks / 2;
+		_taken[i] = 0;
+	}
+	return _ticks;
+}
+// Shortest tick the planned move may take without stepping any axis past
+// its maximum speed
+unsigned long Axes::Delay(){
+	return _delay;
+}
+unsigned char Axes::Mask(){
+	return _mask;
+}
+// Advances every axis due a step, or with slack left and otherwise idle,
+// and returns their data pins gray coded from the new motor positions.
+unsigned char Axes::Tick(){
+	int bits = 0;
+	for(int i = 0; i < AXES_MAX; i++){
+		_err[i] += _inc[i];
+		int step = -(_err[i] >= _ticks);
+		_err[i] -= step & _ticks;
+		int slack = ~step & -(_slack[i] > 0);
+		_slack[i] += slack;
+		step |= slack;
+		_taken[i] -= step;
+		int phase = (_phase[i] + (step & _dir[i])) & 3;
+		_phase[i] = phase;
+		bits |= (-((phase ^ (phase >> 1)) & 1) & _low[i]) | (-(phase >> 1) & _high[i]);
+	}
+	return bits;
+}
+// Hands the motor positions back to the steppers. A move cut short leaves
+// the axis at the steps it took past the slack, give or take the screw
+// correction between.
+void Axes::Store(deque<Stepper> & steppers){
+	for(int i = 0; i < _count; i++){
+		long motor = _motor[i] + (long) _taken[i] * _dir[i];
+		long pos = _target[i];
+		if (motor != steppers[i].Motor(pos, _dir[i])){
+			long slack = (_dir[i] != _last[i] ? steppers[i].getBacklash() : 0) - _slack[i];
+			pos = _pos[i] + (_taken[i] - slack) * _dir[i];
+		}
+		steppers[i].Place(pos, motor, _dir[i]);
+		_pos[i] = _target[i] = pos;
+		_motor[i] = motor;
+		_last[i] = _dir[i];
+		_taken[i] = _slack[i] = 0;
+	}
+}
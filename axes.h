@@ -0,0 +1,49 @@
+#ifndef ___AXES_H__
+#define ___AXES_H__
+#include "cnc.h"
+#include <deque>
+#include <vector>
+#include <climits>
+
+// Most ticks in one move. The error terms reach up to twice the ticks, so
+// longer moves would overflow them and must be split by the caller.
+#define AXES_TICKS (INT_MAX / 2)
+
+// Step execution state of all steppers as contiguous arrays, so one tick
+// of a coordinated move is a single branch-free loop over the axes that
+// vectorizes with plain SSE2. Names, units and speeds stay in the Stepper
+// objects it is loaded from. Unused slots have no increment and no pins and
+// never contribute to the port. Plan refuses moves over AXES_TICKS ticks.
+// Ticks run on motor steps: lead screw corrections are folded into the
+// increments, and backlash on a reversal is taken up as slack steps in the
+// first ticks the axis would otherwise idle, all within the same move.
+class Axes{
+protected:
+	int _count;
+	int _ticks;
+	unsigned long _delay;
+	std::deque<Stepper> & _steppers;
+	long _pos[AXES_MAX];
+	long _motor[AXES_MAX];
+	long _target[AXES_MAX];
+	unsigned long _least[AXES_MAX];
+	int _last[AXES_MAX];
+	int _err[AXES_MAX] __attribute__((aligned(32)));
+	int _inc[AXES_MAX] __attribute__((aligned(32)));
+	int _dir[AXES_MAX] __attribute__((aligned(32)));
+	int _phase[AXES_MAX] __attribute__((aligned(32)));
+	int _slack[AXES_MAX] __attribute__((aligned(32)));
+	int _taken[AXES_MAX] __attribute__((aligned(32)));
+	int _low[AXES_MAX] __attribute__((aligned(32)));
+	int _high[AXES_MAX] __attribute__((aligned(32)));
+	unsigned char _mask;
+public:
+	Axes(std::deque<Stepper> & steppers);
+	long Plan(const long * target);
+	unsigned long Delay();
+	unsigned char Mask();
+	unsigned char Tick();
+	void Store(std::deque<Stepper> & steppers);
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/time.h>
+#include "cnc.h"
+#include "gcode.h"
+#include "job.h"
+#include "preflight.h"
+#include "axes.h"
+
+using namespace std;
+
+static double now(){
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void report(const string & name, double bytes, double seconds){
+	cout << name << ": " << seconds << " s, " << bytes / seconds / 1e9 << " GB/s" << endl;
+}
+
+int main (int argc, char * argv[]){
+	string file = "/tmp/cnc_bench.nc";
+	unsigned long megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 256;
+
+	ofstream out(file.c_str());
+	srand(1);
+	for(unsigned long bytes = 0; bytes < megabytes << 20;){
+		char line[96];
+		int n = snprintf(line, sizeof(line), "G1 X%.4f Y%.4f Z%.4f F%d\n",
+			rand() % 200000 / 1e3, rand() % 200000 / 1e3, -(rand() % 5000) / 1e3, 600 + rand() % 1200);
+		out.write(line, n);
+		bytes += n;
+	}
+	out.close();
+
+	Machine m;
+	ParallelPort port;
+	m.setPort(&port);
+	istringstream conf("Bench\nStepper X 0 200 mm\nStepper Y 2 200 mm\nStepper Z 4 200 mm\n"
+		"Limit X 0 200 5000 1e9\nLimit Y 0 200 5000 1e9\nLimit Z -5 0 5000 1e9\n");
+	conf >> m;
+
+	Gcode in;
+	vector<Word> words;
+	unsigned long count = 0;
+	double start = now();
+	in.Open(file);
+	while (in.Next(words))
+		count += words.size();
+	report("tokenize", in.Size(), now() - start);
+	cout << count << " words" << endl;
+
+	Job job(&m);
+	start = now();
+	in.Open(file);
+	in >> job;
+	report("load", in.Size(), now() - start);
+	cout << job.blocks.size() << " blocks" << endl;
+
+	vector<long> origin(m.steppers.size(), 0);
+	start = now();
+	Preflight preflight(&m, origin, job.blocks);
+	bool passed = preflight.Run();
+	double seconds = now() - start;
+	cout << "preflight: " << seconds << " s, " << job.blocks.size() / seconds / 1e6 << " Mblocks/s"
+		<< (passed ? "" : ", failed: " + preflight.Error) << endl;
+
+	// Step generation without the port: the per-Stepper loop moves used
+	// before, against the contiguous axis state.
+	long ticks = 1 << 24;
+	int n = m.steppers.size();
+	vector<long> target(n), err(n, ticks / 2);
+	for(int i = 0; i < n; i++)
+		target[i] = ticks >> i;
+	unsigned char bits = 0;
+	start = now();
+	for(long t = 0; t < ticks; t++){
+		bits = 0;
+		for(int i = 0; i < n; i++){
+			if ((err[i] += target[i]) >= ticks){
+				err[i] -= ticks;
+				m.steppers[i].Advance(1);
+			}
+			bits |= m.steppers[i].Bits();
+		}
+	}
+	seconds = now() - start;
+	cout << "steppers: " << seconds << " s, " << ticks / seconds / 1e6 << " Mticks/s (" << (int) bits << ')' << endl;
+	for(int i = 0; i < n; i++)
+		m.steppers[i].Place(0, 0, 1);
+	Axes axes(m.steppers);
+	ticks = axes.Plan(&target[0]);
+	start = now();
+	for(long t = 0; t < ticks; t++)
+		bits = axes.Tick();
+	seconds = now() - start;
+	cout << "axes: " << seconds << " s, " << ticks / seconds / 1e6 << " Mticks/s (" << (int) bits << ')' << endl;
+
+	remove(file.c_str());
+	return 0;
+}
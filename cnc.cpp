@@ -1,4 +1,9 @@
 #include "cnc.h"
+#include "axes.h"
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
 
 using namespace std;
 
@@ -15,13 +20,16 @@ Onoff::Onoff(){
 	_port = NULL;
 	_offset = 0x10;
 }
+unsigned char Onoff::Mask(){
+	return 1 << _offset;
+}
 void Onoff::Nudge(bool state){
 	_port->Data((_port->Data() & (~(1 << _offset))) | ((_state = state) << _offset));
 	cout << Name << " (" << (int) _offset << "): " << (_state ? "on" : "off") << ' ' << endl;	
 }
 bool Onoff::set(bool state){
 	Nudge(state);
-	usleep(_delay);
+	_port->Sleep(_delay);
 	return _state;
 }
 bool Onoff::get(){
@@ -67,15 +75,27 @@ Stepper::Stepper(){
 	_state = 0;
 	_delay = 0;
 	_pos = 0;
+	_motor = 0;
+	_dir = 1;
+	_backlash = 0;
+	_origin = 0;
+	_pitch = 0;
 	_port = NULL;
 	_offset = 0x10;
+	setLimits(-HUGE_VALL, HUGE_VALL, 0, 0);
 }
 Stepper::Stepper(unsigned steps, unsigned short offset, ParallelPort * port){
 	_steps = steps;
 	_state = 0;
 	_delay =0;
 	_pos = 0;
+	_motor = 0;
+	_dir = 1;
+	_backlash = 0;
+	_origin = 0;
+	_pitch = 0;
 	_port = port;
+	setLimits(-HUGE_VALL, HUGE_VALL, 0, 0);
 	if (offset > 6){
 		cerr << "Bad offset" << endl;
 		_offset = 0x10;
@@ -86,12 +106,24 @@ Stepper::Stepper(unsigned steps, unsigned short offset, ParallelPort * port){
 		cerr << "Bad stepper amount: " << _steps << endl;
 	}
 }
+// Declares the axis at pos. The phase follows the motor count, so the
+// next push puts the motor where the corrections say it is.
 long Stepper::setPos(long pos){
-	return _pos = pos;
+	Place(pos, Motor(pos, _dir), _dir);
+	return _pos;
 }
 long Stepper::getPos(){
 	return _pos;
 }
+unsigned Stepper::getSteps(){
+	return _steps;
+}
+unsigned char Stepper::Mask(){
+	return 3 << _offset;
+}
+unsigned char Stepper::Bits(){
+	return _state << _offset;
+}
 unsigned long Stepper::setDelay(unsigned long delay){
 	_speed = minute / delay * _steps;
 	return _delay = delay;
@@ -99,9 +131,10 @@ unsigned long Stepper::setDelay(unsigned long delay){
 unsigned long Stepper::getDelay(){
 	return _delay;
 }
+// Delay rounded up, so steps never come faster than speed
 long double Stepper::setSpeed(long double speed){
 	if (speed > 0)
-		_delay = minute / ((_speed = speed) * _steps);
+		_delay = (unsigned long) ceill(minute / ((_speed = speed) * _steps));
 	else
 		_delay = _speed = 0;
 	return _speed;
@@ -109,22 +142,105 @@ long double Stepper::setSpeed(long double speed){
 long double Stepper::getSpeed(){
 	return _speed;
 }
+// Travel in units, speed in units/minute, acceleration in units/minute^2.
+// Zero speed or acceleration means unchecked.
+void Stepper::setLimits(long double min, long double max, long double maxSpeed, long double accel){
+	_min = min;
+	_max = max;
+	_maxSpeed = maxSpeed;
+	_accel = accel;
+}
+long double Stepper::getMin(){
+	return _min;
+}
+long double Stepper::getMax(){
+	return _max;
+}
+long double Stepper::getMaxSpeed(){
+	return _maxSpeed;
+}
+long double Stepper::getAccel(){
+	return _accel;
+}
+// Play taken up when the axis reverses, in units
+void Stepper::setBacklash(long double backlash){
+	_backlash = (long) floorl(backlash * _steps + 0.5);
+	Place(_pos, Motor(_pos, _dir), _dir);
+}
+// Lead screw error measured every pitch units from origin, as actual minus
+// commanded travel in units. Kept as step corrections at those points.
+void Stepper::setScrew(long double origin, long double pitch, const vector<long double> & errors){
+	_origin = (long) floorl(origin * _steps + 0.5);
+	_pitch = (long) floorl(pitch * _steps + 0.5);
+	_screw.clear();
+	if (_pitch > 0)
+		for(int i = 0; i < errors.size(); i++)
+			_screw.push_back((long) floorl(-errors[i] * _steps + 0.5));
+	for(int i = 1; i < _screw.size(); i++)
+		if (labs(_screw[i] - _screw[i - 1]) >= _pitch){
+			cerr << Name << ": screw error changes faster than travel, ignored" << endl;
+			_screw.clear();
+		}
+	Place(_pos, Motor(_pos, _dir), _dir);
+}
+long Stepper::getBacklash(){
+	return _backlash;
+}
+long Stepper::getMotor(){
+	return _motor;
+}
+char Stepper::getDir(){
+	return _dir;
+}
+// Screw correction in steps at pos, interpolated between table points and
+// held at the ends
+long Stepper::Screw(long pos){
+	if (_screw.empty())
+		return 0;
+	long at = pos - _origin, last = _screw.size() - 1;
+	if (at <= 0)
+		return _screw[0];
+	if (at >= last * _pitch)
+		return _screw[last];
+	long k = at / _pitch, r = at % _pitch;
+	long double f = (long double) (_screw[k + 1] - _screw[k]) * r / _pitch;
+	return _screw[k] + (long) floorl(f + 0.5);
+}
+// Motor step count that puts the axis at pos when it got there moving in dir
+long Stepper::Motor(long pos, char dir){
+	return pos + Screw(pos) - (dir < 0 ? _backlash : 0);
+}
 void Stepper::Nudge(){
 	_port->Data((_port->Data() & (~(3 << _offset))) | (_state << _offset));
 	cout << Name << " (" << (int) _offset << ',' << (int) _offset + 1 << "): " <<_state << ' ' << _pos << ' ' << endl;
 }
 void Stepper::Push(){
 	Nudge();
-	usleep(_delay);
+	_port->Sleep(_delay);
+}
+void Stepper::Place(long pos, long motor, char dir){
+	_pos = pos;
+	_motor = motor;
+	_dir = dir;
+	_state = graycode2[_motor & 3];
+}
+// One motor step, without correction
+void Stepper::Advance(char sign){
+	Place(_pos + sign, _motor + sign, sign);
 }
+// Takes up backlash first on reversal, then steps the motor to the
+// screw corrected position. Never steps against sign.
 void Stepper::Step(int steps){
+	if (!steps)
+		return;
 	char sign = steps < 0 ? -1 : 1;
-	steps *= sign;
-	while(steps-- > 0){
-		_pos += sign;
-		_state = sign > 0 ? graycode2[(_pos) % 4] : graycode2[3 - (3 - _pos) % 4];
+	long pos = _pos + steps, motor = Motor(pos, sign);
+	while((motor - _motor) * sign > 0){
+		Place(_pos, _motor + sign, sign);
 		Push();
 	}
+	_pos = pos;
+	_dir = sign;
 }
 void Stepper::goTo(long pos){
 	Step(pos - _pos);
@@ -144,20 +260,41 @@ ostream& operator << (std::ostream & outfile, Stepper & d){
 	outfile << "Pins: " << d._offset << ',' << d._offset + 1 << endl;
 	outfile << "Steps: " << d._steps << " step/" << d.Unit << endl;
 	outfile << "Speed: " << d._speed << ' ' << d.Unit << "/minute" << endl;
+	if (d._min > -HUGE_VALL or d._max < HUGE_VALL)
+		outfile << "Travel: " << d._min << " to " << d._max << ' ' << d.Unit << endl;
+	if (d._maxSpeed > 0)
+		outfile << "Maximum speed: " << d._maxSpeed << ' ' << d.Unit << "/minute" << endl;
+	if (d._accel > 0)
+		outfile << "Acceleration: " << d._accel << ' ' << d.Unit << "/minute^2" << endl;
+	if (d._backlash)
+		outfile << "Backlash: " << d._backlash << " step" << endl;
+	if (d._screw.size())
+		outfile << "Screw table: " << d._screw.size() << " points every " << d._pitch << " step" << endl;
 	outfile << "Position: " << d._pos << " step" << endl;
 	return outfile;
 }
 
+Machine::Machine(){
+	_port = NULL;
+	Tolerance = 0;
+}
 ParallelPort * Machine::setPort(ParallelPort * port){
 	_port = port;
 	for(int i = 0; i < steppers.size(); i++)
 		steppers[i].setPort(port);
 	for(int i = 0; i < onoffs.size(); i++)
 		onoffs[i].setPort(port);
+	return port;
 }
 ParallelPort * Machine::getPort(){
 	return _port;
 }
+int Machine::Axis(char letter){
+	for(int i = 0; i < steppers.size(); i++)
+		if (steppers[i].Name.length() and toupper(steppers[i].Name[0]) == toupper(letter))
+			return i;
+	return -1;
+}
 void Machine::Zero(){
 	_port->Data(0);
 	for(int i = 0; i < steppers.size(); i++){
@@ -168,6 +305,82 @@ void Machine::Zero(){
 		onoffs[i].set(false);
 	}
 }
+void Machine::Move(const long * target, long double feed){
+	Axes axes(steppers);
+	long ticks = axes.Plan(target);
+	long double length = 0, rapid = 0;
+	if (!ticks)
+		return;
+	if (ticks < 0){
+		// Too many steps for one go, run it as two halves
+		vector<long> half(steppers.size());
+		bool split = false;
+		for(int i = 0; i < steppers.size(); i++){
+			long pos = steppers[i].getPos();
+			half[i] = pos + (target[i] - pos) / 2;
+			split |= half[i] != pos;
+		}
+		if (!split){
+			cerr << "Backlash too large to take up in one move" << endl;
+			return;
+		}
+		Move(&half[0], feed);
+		Move(target, feed);
+		return;
+	}
+	for(int i = 0; i < steppers.size(); i++){
+		long d = labs(target[i] - steppers[i].getPos());
+		length += powl((long double) d / steppers[i].getSteps(), 2);
+		if (d * (long double) steppers[i].getDelay() > rapid)
+			rapid = d * (long double) steppers[i].getDelay();
+	}
+	// Slack and screw corrections add ticks to the commanded distance, so the
+	// move stretches over them rather than step any axis past its speed
+	unsigned long delay = (unsigned long) ((feed > 0 ? sqrtl(length) / feed * minute : rapid) / ticks);
+	if (delay < axes.Delay())
+		delay = axes.Delay();
+	unsigned char keep = _port->Data() & ~axes.Mask();
+	try{
+		for(long t = 0; t < ticks; t++){
+			_port->Data(keep | axes.Tick());
+			_port->Sleep(delay);
+		}
+	}catch (ParallelPort_errors){
+		axes.Store(steppers);
+		throw;
+	}
+	axes.Store(steppers);
+}
+// Arc in the XY plane around (cx, cy), in units, split into chords that
+// stay within half a step of the arc. Other axes move linearly.
+void Machine::Arc(const long * target, long double cx, long double cy, bool clockwise, long double feed){
+	int x = Axis('X'), y = Axis('Y'), n = steppers.size();
+	long double sx = steppers[x].getSteps(), sy = steppers[y].getSteps();
+	long double ax = steppers[x].getPos() / sx - cx, ay = steppers[y].getPos() / sy - cy;
+	long double bx = target[x] / sx - cx, by = target[y] / sy - cy;
+	long double r0 = sqrtl(ax * ax + ay * ay), r1 = sqrtl(bx * bx + by * by);
+	long double a0 = atan2l(ay, ax), sweep = atan2l(by, bx) - a0;
+	if (clockwise and sweep >= 0)
+		sweep -= 2 * M_PI;
+	else if (!clockwise and sweep <= 0)
+		sweep += 2 * M_PI;
+	long double error = 0.5 / (sx > sy ? sx : sy), r = r0 > r1 ? r0 : r1;
+	long chords = 1;
+	if (r > error)
+		chords = (long) ceill(fabsl(sweep) / (2 * acosl(1 - error / r)));
+	vector<long> start(n), chord(n);
+	for(int i = 0; i < n; i++)
+		start[i] = steppers[i].getPos();
+	for(long k = 1; k < chords; k++){
+		long double f = (long double) k / chords, a = a0 + sweep * f, rk = r0 + (r1 - r0) * f;
+		for(int i = 0; i < n; i++)
+			chord[i] = start[i] + (long) floorl((target[i] - start[i]) * f + 0.5);
+		chord[x] = (long) floorl((cx + rk * cosl(a)) * sx + 0.5);
+		chord[y] = (long) floorl((cy + rk * sinl(a)) * sy + 0.5);
+		Move(&chord[0], feed);
+	}
+	Move(target, feed);
+}
 istream& operator >> (istream & infile, Machine& d){
 	string type;
 	Stepper Sdump;
@@ -180,12 +393,55 @@ istream& operator >> (istream & infile, Machine& d){
 				infile >> Sdump;
 				Sdump.setPort(d._port);
 				Sdump.setSpeed(1);
-				d.steppers.push_back(Sdump);
+				if (d.steppers.size() < AXES_MAX)
+					d.steppers.push_back(Sdump);
+				else
+					cerr << "Only " << AXES_MAX << " steppers supported, " << Sdump.Name << " ignored" << endl;
 			}else if (type == "Onoff"){
 				infile >> Odump;
 				Odump.setPort(d._port);
 				Odump.setSpeed(60);
 				d.onoffs.push_back(Odump);
+			}else if (type == "Tolerance")
+				infile >> d.Tolerance;
+			else if (type == "Limit"){
+				char axis;
+				long double min, max, speed, accel;
+				infile >> axis >> min >> max >> speed >> accel;
+				int i = d.Axis(axis);
+				if (i < 0)
+					cerr << "No axis " << axis << " to limit" << endl;
+				else{
+					d.steppers[i].setLimits(min, max, speed, accel);
+					if (speed > 0)	// rapids run at the maximum speed
+						d.steppers[i].setSpeed(speed);
+				}
+			}else if (type == "Backlash"){
+				char axis;
+				long double backlash;
+				infile >> axis >> backlash;
+				int i = d.Axis(axis);
+				if (i < 0)
+					cerr << "No axis " << axis << " for backlash" << endl;
+				else if (backlash < 0)
+					cerr << "Negative backlash on " << axis << " ignored" << endl;
+				else
+					d.steppers[i].setBacklash(backlash);
+			}else if (type == "Screw"){
+				char axis;
+				long double origin, pitch, error;
+				vector<long double> errors;
+				string line;
+				infile >> axis >> origin >> pitch;
+				getline(infile, line);
+				istringstream values(line);
+				while (values >> error)
+					errors.push_back(error);
+				int i = d.Axis(axis);
+				if (i < 0)
+					cerr << "No axis " << axis << " for screw table" << endl;
+				else
+					d.steppers[i].setScrew(origin, pitch, errors);
 			}
 		}
 	}
@@ -198,6 +454,8 @@ ostream& operator << (ostream & outfile, Machine & d){
 		outfile << "open port: " << d._port->PortName() << endl;
 	else
 		outfile << "closed port";
+	if (d.Tolerance > 0)
+		outfile << "Path tolerance: " << d.Tolerance << endl;
 	outfile << "Actuators: " << endl;
 	outfile << d.steppers.size() << " Stepper motor" << ((d.steppers.size() != 1) ? "s" : "") << (d.steppers.size() ? ":" : "") << endl;
 	for(int i = 0; i < d.steppers.size(); i++)
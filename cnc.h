@@ -1,11 +1,14 @@
 #ifndef ___CNC_H__
+#define ___CNC_H__
 #include "ParallelPort.h"
 #include <iostream>
 #include <string>
 #include <deque>
+#include <vector>
 
 #define second (1000000)
 #define minute (60 * second)
+#define AXES_MAX 8
 
 const unsigned graycode2[4] = {0, 1, 3, 2};
 
@@ -26,6 +29,7 @@ protected:
 	long double _speed;
 public:
 	Onoff();
+	unsigned char Mask();
 	void Nudge(bool state);
 	bool set(bool state);
 	bool get();
@@ -44,18 +48,41 @@ protected:
 	long double _speed;
 	unsigned _state : 2;
 	long _pos;
+	long _motor;
+	char _dir;
+	long double _min, _max, _maxSpeed, _accel;
+	long _backlash;
+	long _origin, _pitch;
+	std::vector<long> _screw;
 public:
 	std::string Unit;
 	Stepper();
 	Stepper(unsigned steps, unsigned short offset, ParallelPort * port);
 	long setPos(long pos);
 	long getPos();
+	unsigned getSteps();
+	unsigned char Mask();
+	unsigned char Bits();
 	unsigned long setDelay(unsigned long delay);
 	unsigned long getDelay();
 	long double setSpeed(long double speed);
 	long double getSpeed();
+	void setLimits(long double min, long double max, long double maxSpeed, long double accel);
+	long double getMin();
+	long double getMax();
+	long double getMaxSpeed();
+	long double getAccel();
+	void setBacklash(long double backlash);
+	void setScrew(long double origin, long double pitch, const std::vector<long double> & errors);
+	long getBacklash();
+	long getMotor();
+	char getDir();
+	long Screw(long pos);
+	long Motor(long pos, char dir);
 	void Nudge();
 	void Push();
+	void Place(long pos, long motor, char dir);
+	void Advance(char sign);
 	void Step(int steps);
 	void goTo(long pos);
 	friend std::istream& operator >> (std::istream & in, Stepper & d);
@@ -69,9 +96,14 @@ public:
 	std::string Name;
 	std::deque<Stepper> steppers;
 	std::deque<Onoff> onoffs;
+	long double Tolerance;
+	Machine();
 	ParallelPort * setPort(ParallelPort * port);
 	ParallelPort * getPort();
+	int Axis(char letter);
 	void Zero();
+	void Move(const long * target, long double feed);
+	void Arc(const long * target, long double cx, long double cy, bool clockwise, long double feed);
 	friend std::istream& operator >> (std::istream & infile, Machine & d);
 	friend std::ostream& operator << (std::ostream & outfile, Machine & d);
 };
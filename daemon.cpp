@@ -0,0 +1,275 @@
+#include "daemon.h"
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <ctime>
+
+using namespace std;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int){
+	stopping = 1;
+}
+
+JobQueue::JobQueue(){
+	pthread_mutex_init(&_lock, NULL);
+	pthread_cond_init(&_ready, NULL);
+	pthread_cond_init(&_empty, NULL);
+	_closed = false;
+}
+JobQueue::~JobQueue(){
+	pthread_cond_destroy(&_empty);
+	pthread_cond_destroy(&_ready);
+	pthread_mutex_destroy(&_lock);
+}
+void JobQueue::push(Job * job){
+	pthread_mutex_lock(&_lock);
+	_jobs.push_back(job);
+	pthread_cond_signal(&_ready);
+	pthread_mutex_unlock(&_lock);
+}
+Job * JobQueue::pop(){
+	Job * job = NULL;
+	pthread_mutex_lock(&_lock);
+	while (_jobs.empty() and !_closed)
+		pthread_cond_wait(&_ready, &_lock);
+	if (!_jobs.empty()){
+		job = _jobs.front();
+		_jobs.pop_front();
+	}
+	if (_jobs.empty())
+		pthread_cond_broadcast(&_empty);
+	pthread_mutex_unlock(&_lock);
+	return job;
+}
+// Waits until every job pushed has been taken
+void JobQueue::wait(){
+	pthread_mutex_lock(&_lock);
+	while (!_jobs.empty())
+		pthread_cond_wait(&_empty, &_lock);
+	pthread_mutex_unlock(&_lock);
+}
+void JobQueue::close(){
+	pthread_mutex_lock(&_lock);
+	_closed = true;
+	pthread_cond_broadcast(&_ready);
+	pthread_mutex_unlock(&_lock);
+}
+
+void Report(int fd, const string & message){
+	string line = message + '\n';
+	if (fd >= 0)
+		send(fd, line.data(), line.length(), MSG_NOSIGNAL);
+}
+
+Daemon::Daemon(Machine * machine, const string & path){
+	_machine = machine;
+	_path = path;
+	_fd = -1;
+	_epoch = 0;
+	pthread_mutex_init(&_lock, NULL);
+	for(int i = 0; i < machine->steppers.size(); i++)
+		_planned.push_back(machine->steppers[i].getPos());
+}
+Daemon::~Daemon(){
+	pthread_mutex_destroy(&_lock);
+}
+void * Daemon::parser(void * d){
+	Daemon & daemon = *(Daemon *) d;
+	Job * job;
+	for(;;){
+		daemon._parsed.wait();
+		if (!(job = daemon._pending.pop()))
+			break;
+		if (stopping){
+			Report(job->client, "error: daemon stopping");
+			close(job->client);
+			delete job;
+			continue;
+		}
+		pthread_mutex_lock(&daemon._lock);
+		job->pos = daemon._planned;
+		job->epoch = daemon._epoch;
+		pthread_mutex_unlock(&daemon._lock);
+		if (!job->Load()){
+			Report(job->client, "error: " + job->Error);
+			close(job->client);
+			delete job;
+			continue;
+		}
+		pthread_mutex_lock(&daemon._lock);
+		if (job->epoch == daemon._epoch)
+			daemon._planned = job->pos;
+		pthread_mutex_unlock(&daemon._lock);
+		ostringstream message;
+		message << "queued " << job->blocks.size() << " blocks";
+		Report(job->client, message.str());
+		daemon._parsed.push(job);
+	}
+	daemon._parsed.close();
+	return NULL;
+}
+void * Daemon::executor(void * d){
+	Daemon & daemon = *(Daemon *) d;
+	Job * job;
+	while ((job = daemon._parsed.pop())){
+		unsigned long total = job->blocks.size(), percent = 0;
+		pthread_mutex_lock(&daemon._lock);
+		bool stale = job->epoch != daemon._epoch;
+		pthread_mutex_unlock(&daemon._lock);
+		if (stale){
+			Report(job->client, "error: planned past a failed job, submit again");
+			close(job->client);
+			delete job;
+			continue;
+		}
+		Report(job->client, "running");
+		bool failed = false;
+		try{
+			for(unsigned long i = 0; i < total and !stopping; i++){
+				job->Execute(job->blocks[i]);
+				if ((i + 1) * 100 / total != percent){
+					ostringstream message;
+					message << "progress " << (percent = (i + 1) * 100 / total) << '%';
+					Report(job->client, message.str());
+				}
+			}
+			failed = stopping;
+			Report(job->client, stopping ? "aborted" : "done");
+		}catch (ParallelPort_errors){
+			failed = true;
+			Report(job->client, "error: port");
+		}
+		if (failed){
+			pthread_mutex_lock(&daemon._lock);
+			daemon._epoch++;
+			for(int i = 0; i < daemon._planned.size(); i++)
+				daemon._planned[i] = daemon._machine->steppers[i].getPos();
+			pthread_mutex_unlock(&daemon._lock);
+		}
+		close(job->client);
+		delete job;
+	}
+	return NULL;
+}
+void Daemon::Run(){
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, _path.c_str(), sizeof(addr.sun_path) - 1);
+	unlink(_path.c_str());
+	if ((_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+			or bind(_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0
+			or listen(_fd, 16) < 0){
+		cerr << "Cannot listen on " << _path << endl;
+		return;
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	sigset_t signals, old;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, &old);
+	pthread_create(&_parser, NULL, parser, this);
+	pthread_create(&_executor, NULL, executor, this);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	// Clients are polled until they have sent their job path, so one that
+	// sends nothing only holds up itself until CLIENT_TIMEOUT.
+	vector<Job *> waiting;
+	vector<time_t> since;
+	cout << "Listening on " << _path << endl;
+	while (!stopping){
+		vector<struct pollfd> fds(waiting.size() + 1);
+		fds[0].fd = _fd;
+		fds[0].events = POLLIN;
+		for(int i = 0; i < waiting.size(); i++){
+			fds[i + 1].fd = waiting[i]->client;
+			fds[i + 1].events = POLLIN;
+		}
+		if (poll(&fds[0], fds.size(), 1000) < 0)
+			continue;
+		time_t now = time(NULL);
+		for(int i = waiting.size() - 1; i >= 0; i--){
+			Job * job = waiting[i];
+			char buffer[256];
+			ssize_t n = 0;
+			if (fds[i + 1].revents)
+				n = recv(job->client, buffer, sizeof(buffer), MSG_DONTWAIT);
+			if (n > 0)
+				job->Name.append(buffer, n);
+			size_t end = job->Name.find('\n');
+			if (end != string::npos){
+				job->Name.erase(end);
+				_pending.push(job);
+			}else if (fds[i + 1].revents and n <= 0){
+				close(job->client);
+				delete job;
+			}else if (now - since[i] > CLIENT_TIMEOUT){
+				Report(job->client, "error: no job path");
+				close(job->client);
+				delete job;
+			}else
+				continue;
+			waiting.erase(waiting.begin() + i);
+			since.erase(since.begin() + i);
+		}
+		if (fds[0].revents & POLLIN){
+			int client = accept(_fd, NULL, NULL);
+			if (client >= 0){
+				waiting.push_back(new Job(_machine, false));
+				waiting.back()->client = client;
+				since.push_back(now);
+			}
+		}
+	}
+	for(int i = 0; i < waiting.size(); i++){
+		close(waiting[i]->client);
+		delete waiting[i];
+	}
+
+	_pending.close();
+	pthread_join(_parser, NULL);
+	pthread_join(_executor, NULL);
+	close(_fd);
+	unlink(_path.c_str());
+}
+
+int Submit(const string & job, const string & path){
+	struct sockaddr_un addr;
+	char full[PATH_MAX];
+	if (!realpath(job.c_str(), full))
+		return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0){
+		close(fd);
+		return -1;
+	}
+	Report(fd, full);
+	return fd;
+}
+void Follow(int fd, ostream & out){
+	char buffer[256];
+	ssize_t n;
+	while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+		out.write(buffer, n);
+	out.flush();
+	close(fd);
+}
@@ -0,0 +1,60 @@
+#ifndef ___DAEMON_H__
+#define ___DAEMON_H__
+#include "cnc.h"
+#include "job.h"
+#include <string>
+#include <deque>
+#include <vector>
+#include <pthread.h>
+
+#define SOCKET_PATH "/tmp/cnc.sock"
+#define CLIENT_TIMEOUT 5
+
+class JobQueue{
+protected:
+	std::deque<Job *> _jobs;
+	pthread_mutex_t _lock;
+	pthread_cond_t _ready;
+	pthread_cond_t _empty;
+	bool _closed;
+public:
+	JobQueue();
+	~JobQueue();
+	void push(Job * job);
+	Job * pop();
+	void wait();
+	void close();
+};
+
+// Owns the machine for its whole lifetime and runs jobs submitted over a
+// Unix domain socket. Jobs are parsed by one thread while the previous job
+// is still being executed by another, at most one job ahead so queued jobs
+// do not all sit in memory as blocks. Each job is planned from where the
+// one before it ends; when a job fails or is aborted, the jobs already
+// planned behind it are rejected and planning restarts from where the
+// machine stopped.
+class Daemon{
+protected:
+	Machine * _machine;
+	std::string _path;
+	int _fd;
+	JobQueue _pending;
+	JobQueue _parsed;
+	std::vector<long> _planned;
+	unsigned long _epoch;
+	pthread_mutex_t _lock;
+	pthread_t _parser;
+	pthread_t _executor;
+	static void * parser(void * d);
+	static void * executor(void * d);
+public:
+	Daemon(Machine * machine, const std::string & path = SOCKET_PATH);
+	~Daemon();
+	void Run();
+};
+
+int Submit(const std::string & job, const std::string & path = SOCKET_PATH);
+void Follow(int fd, std::ostream & out);
+void Report(int fd, const std::string & message);
+
+#endif
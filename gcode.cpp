@@ -0,0 +1,262 @@
+#include "gcode.h"
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+static const int64_t digits10[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+static const double power10[19] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+// Classifies the 64 bytes from p into bit masks: blank, special for a
+// newline, ';', '(', '%' or past end, and number for digits, '.', '+' and
+// '-'. Words start at the bytes in none of them.
+static inline void classify(const char * p, const char * end, uint64_t & blank, uint64_t & special, uint64_t & number){
+	blank = special = number = 0;
+	if (end - p >= 64){
+#if defined(__AVX2__)
+		const __m256i nl = _mm256_set1_epi8('\n'), sc = _mm256_set1_epi8(';'), pa = _mm256_set1_epi8('('), pc = _mm256_set1_epi8('%');
+		const __m256i sp = _mm256_set1_epi8(' '), tb = _mm256_set1_epi8('\t'), cr = _mm256_set1_epi8('\r');
+		const __m256i dot = _mm256_set1_epi8('.'), plus = _mm256_set1_epi8('+'), minus = _mm256_set1_epi8('-');
+		const __m256i shift = _mm256_set1_epi8(0x80 - '0'), ten = _mm256_set1_epi8(-128 + 10);
+		for(int i = 0; i < 64; i += 32){
+			__m256i v = _mm256_loadu_si256((const __m256i *) (p + i));
+			uint64_t s = (unsigned) _mm256_movemask_epi8(_mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, sc)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, pa), _mm256_cmpeq_epi8(v, pc))));
+			uint64_t b = (unsigned) _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, tb), _mm256_cmpeq_epi8(v, cr))));
+			uint64_t n = (unsigned) _mm256_movemask_epi8(_mm256_or_si256(
+				_mm256_cmpgt_epi8(ten, _mm256_add_epi8(v, shift)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, dot), _mm256_or_si256(_mm256_cmpeq_epi8(v, plus), _mm256_cmpeq_epi8(v, minus)))));
+			special |= s << i;
+			blank |= b << i;
+			number |= n << i;
+		}
+		return;
+#elif defined(__SSE2__)
+		const __m128i nl = _mm_set1_epi8('\n'), sc = _mm_set1_epi8(';'), pa = _mm_set1_epi8('('), pc = _mm_set1_epi8('%');
+		const __m128i sp = _mm_set1_epi8(' '), tb = _mm_set1_epi8('\t'), cr = _mm_set1_epi8('\r');
+		const __m128i dot = _mm_set1_epi8('.'), plus = _mm_set1_epi8('+'), minus = _mm_set1_epi8('-');
+		const __m128i shift = _mm_set1_epi8(0x80 - '0'), ten = _mm_set1_epi8(-128 + 10);
+		for(int i = 0; i < 64; i += 16){
+			__m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+			uint64_t s = _mm_movemask_epi8(_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, sc)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, pa), _mm_cmpeq_epi8(v, pc))));
+			uint64_t b = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, sp),
+				_mm_or_si128(_mm_cmpeq_epi8(v, tb), _mm_cmpeq_epi8(v, cr))));
+			uint64_t n = _mm_movemask_epi8(_mm_or_si128(
+				_mm_cmplt_epi8(_mm_add_epi8(v, shift), ten),
+				_mm_or_si128(_mm_cmpeq_epi8(v, dot), _mm_or_si128(_mm_cmpeq_epi8(v, plus), _mm_cmpeq_epi8(v, minus)))));
+			special |= s << i;
+			blank |= b << i;
+			number |= n << i;
+		}
+		return;
+#endif
+	}
+	for(int i = 0; i < 64; i++){
+		uint64_t bit = (uint64_t) 1 << i;
+		if (p + i >= end or p[i] == '\n' or p[i] == ';' or p[i] == '(' or p[i] == '%')
+			special |= bit;
+		else if (p[i] == ' ' or p[i] == '\t' or p[i] == '\r')
+			blank |= bit;
+		else if ((unsigned) (p[i] - '0') < 10 or p[i] == '.' or p[i] == '+' or p[i] == '-')
+			number |= bit;
+	}
+}
+
+// Converts the run of up to 8 digits at p, reading 8 bytes. Returns the
+// length of the run.
+static inline int digits8(const char * p, uint64_t & value){
+	uint64_t v;
+	memcpy(&v, p, 8);
+	v ^= 0x3030303030303030ULL;
+	uint64_t bad = (v | (v + 0x0606060606060606ULL)) & 0xF0F0F0F0F0F0F0F0ULL;
+	int n = bad ? __builtin_ctzll(bad) >> 3 : 8;
+	if (!n){
+		value = 0;
+		return 0;
+	}
+	v <<= 8 * (8 - n);
+	v = (v & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;
+	v = (v & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+	value = (v & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32;
+	return n;
+}
+
+// Plain decimal number without exponent, as G-code writes them. Leaves p
+// past the last character used, or where it was if there is no digit.
+static inline double number(const char * & p, const char * end){
+	const char * begin = p;
+	bool negative = false, any = false;
+	unsigned long mantissa = 0;
+	int digits = 0, scale = 0;
+	if (p < end and (*p == '-' or *p == '+'))
+		negative = *p++ == '-';
+	if (end - p >= 17){
+		uint64_t whole, fraction;
+		int n = digits8(p, whole);
+		if (n < 8 and p[n] != '.'){
+			p = n ? p + n : begin;
+			return negative ? -(double) (int64_t) whole : (double) (int64_t) whole;
+		}
+		if (n < 8){
+			int f = digits8(p + n + 1, fraction);
+			if (f < 8 and n + f == 0){
+				p = begin;
+				return 0;
+			}
+			if (f < 8){
+				p += n + 1 + f;
+				double value = (double) (int64_t) (whole * digits10[f] + fraction) / power10[f];
+				return negative ? -value : value;
+			}
+		}
+	}
+	for(; p < end and (unsigned) (*p - '0') < 10; p++, any = true)
+		if (digits < 18){
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa)
+				digits++;
+		}else if (scale > -18)
+			scale--;
+	if (p < end and *p == '.')
+		for(p++; p < end and (unsigned) (*p - '0') < 10; p++, any = true)
+			if (digits < 18 and scale < 18){
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa)
+					digits++;
+				scale++;
+			}
+	if (!any){
+		p = begin;
+		return 0;
+	}
+	double value = scale >= 0 ? mantissa / power10[scale] : mantissa * power10[-scale];
+	return negative ? -value : value;
+}
+
+Gcode::Gcode(){
+	_fd = -1;
+	_data = _at = _end = NULL;
+	_size = 0;
+	_line = 0;
+}
+Gcode::~Gcode(){
+	Close();
+}
+bool Gcode::Open(const string & file){
+	struct stat st;
+	Close();
+	if ((_fd = open(file.c_str(), O_RDONLY)) < 0)
+		return false;
+	if (fstat(_fd, &st) < 0){
+		Close();
+		return false;
+	}
+	_size = st.st_size;
+	if (_size){
+		void * map = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+		if (map == MAP_FAILED){
+			Close();
+			return false;
+		}
+		madvise(map, _size, MADV_SEQUENTIAL);
+		_data = (const char *) map;
+	}
+	_at = _data;
+	_end = _data + _size;
+	return true;
+}
+void Gcode::Close(){
+	if (_data)
+		munmap((void *) _data, _size);
+	if (_fd >= 0)
+		close(_fd);
+	_fd = -1;
+	_data = _at = _end = NULL;
+	_size = 0;
+	_line = 0;
+}
+bool Gcode::IsOpened(){
+	return _fd >= 0;
+}
+size_t Gcode::Size(){
+	return _size;
+}
+unsigned long Gcode::Line(){
+	return _line;
+}
+// Reads a word at p: its letter, blanks, then a number if there is one
+inline void Gcode::word(const char * & p, vector<Word> & words){
+	Word w;
+	w.text = p;
+	w.letter = *p >= 'a' and *p <= 'z' ? *p - 'a' + 'A' : *p;
+	for(p++; p < _end and (*p == ' ' or *p == '\t'); p++);
+	const char * digits = p;
+	w.value = number(p, _end);
+	w.length = p == digits ? 1 : p - w.text;
+	words.push_back(w);
+}
+// Number characters in loose from done on, outside any word as in "X1 5",
+// each start a word of their own that the parser rejects
+inline void Gcode::strays(const char * p, const char * & done, uint64_t loose, vector<Word> & words){
+	uint64_t left;
+	while (done - p < 64 and (left = loose & (~(uint64_t) 0 << (done - p)))){
+		done = p + __builtin_ctzll(left);
+		word(done, words);
+	}
+}
+// Every word start of a 64 byte window is known from the masks up front, so
+// finding the next word does not wait for the number before it.
+bool Gcode::Next(vector<Word> & words){
+	words.clear();
+	if (_at >= _end)
+		return false;
+	_line++;
+	const char * p = _at;
+	for(;;){
+		uint64_t blank, special, number;
+		classify(p, _end, blank, special, number);
+		int stop = special ? __builtin_ctzll(special) : 64;
+		uint64_t inside = stop < 64 ? ((uint64_t) 1 << stop) - 1 : ~(uint64_t) 0;
+		uint64_t starts = ~(blank | special | number) & inside, loose = ~blank & inside;
+		const char * done = p;
+		for(; starts; starts &= starts - 1){
+			const char * at = p + __builtin_ctzll(starts);
+			strays(p, done, loose & ~(~(uint64_t) 0 << (at - p)), words);
+			done = at;
+			word(done, words);
+		}
+		strays(p, done, loose, words);
+		if (stop == 64){
+			p = done > p + 64 ? done : p + 64;
+			continue;
+		}
+		p += stop;
+		if (p >= _end or *p == '\n'){
+			_at = p + (p < _end);
+			return true;
+		}
+		// Comments end at ')' or, unterminated, with their line. A '%'
+		// tape marker skips the rest of its line like ';'.
+		const char * eol = (const char *) memchr(p, '\n', _end - p);
+		if (!eol)
+			eol = _end;
+		const char * close = *p == '(' ? (const char *) memchr(p, ')', eol - p) : NULL;
+		p = close ? close + 1 : eol;
+	}
+}
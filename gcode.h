@@ -0,0 +1,40 @@
+#ifndef ___GCODE_H__
+#define ___GCODE_H__
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+struct Word{
+	char letter;
+	double value;
+	const char * text;
+	unsigned length;
+};
+
+// Memory-mapped G-code reader. Words point into the mapping and stay valid
+// until the file is closed.
+class Gcode{
+protected:
+	int _fd;
+	const char * _data;
+	const char * _at;
+	const char * _end;
+	size_t _size;
+	unsigned long _line;
+	Gcode(const Gcode & g);
+	Gcode operator = (const Gcode & g);
+	void word(const char * & p, std::vector<Word> & words);
+	void strays(const char * p, const char * & done, uint64_t loose, std::vector<Word> & words);
+public:
+	Gcode();
+	~Gcode();
+	bool Open(const std::string & file);
+	void Close();
+	bool IsOpened();
+	size_t Size();
+	unsigned long Line();
+	bool Next(std::vector<Word> & words);
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "job.h"
+#include "simplify.h"
+#include "preflight.h"
+#include <cctype>
+#include <cmath>
+#include <sstream>
+
+using namespace std;
+
+// Starts from the machine's current position unless fromMachine is false,
+// when the caller sets pos itself.
+Job::Job(Machine * machine, bool fromMachine){
+	_machine = machine;
+	client = -1;
+	epoch = 0;
+	pos.resize(machine->steppers.size());
+	if (fromMachine)
+		for(int i = 0; i < pos.size(); i++)
+			pos[i] = machine->steppers[i].getPos();
+}
+Machine * Job::getMachine(){
+	return _machine;
+}
+// Reads Name starting from pos and checks it against the machine's limits
+bool Job::Load(){
+	Gcode infile;
+	vector<long> start = pos;
+	if (!infile.Open(Name))
+		Error = "cannot open " + Name;
+	else
+		infile >> *this;
+	if (Error.empty()){
+		Preflight preflight(_machine, start, blocks);
+		if (!preflight.Run())
+			Error = preflight.Error;
+	}
+	return Error.empty();
+}
+void Job::Execute(const Block & b){
+	if (b.type == Block::Move)
+		_machine->Move(b.target, b.feed);
+	else if (b.type == Block::Arc)
+		_machine->Arc(b.target, b.center[0], b.center[1], b.clockwise, b.feed);
+	else
+		_machine->onoffs[b.device].set(b.state);
+}
+// G-code subset: G0/G1 axis moves with F feed in units/minute, G2/G3 XY
+// arcs with I/J center offsets, G90/G91, M62/M63 Pn to switch on/off
+// device n. Axis letters are matched against the first letter of each
+// stepper name. Other G codes, such as G20 inches or the G18/G19 planes,
+// are refused rather than ignored. Moves go through a Simplifier when the
+// machine has a path tolerance.
+Gcode& operator >> (Gcode & in, Job & d){
+	Machine & m = *d._machine;
+	int axis[26];
+	double scale[26];
+	for(int i = 0; i < 26; i++){
+		axis[i] = m.Axis('A' + i);
+		scale[i] = axis[i] < 0 ? 0 : m.steppers[axis[i]].getSteps();
+	}
+	int x = axis['X' - 'A'], y = axis['Y' - 'A'];
+	int motion = 0;
+	bool relative = false;
+	long double feed = 0;
+	vector<Word> words;
+	Simplifier simplifier(&m, &d.blocks, d.pos);
+	while (in.Next(words)){
+		Block b;
+		b.type = Block::Move;
+		for(int i = 0; i < d.pos.size(); i++)
+			b.target[i] = d.pos[i];
+		b.line = in.Line();
+		bool moved = false;
+		int mcode = -1;
+		long device = -1;
+		long double offset[2] = {0, 0};
+		for(int w = 0; w < words.size(); w++){
+			char letter = words[w].letter;
+			double value = words[w].value;
+			if (words[w].length < 2){
+				ostringstream e;
+				e << "line " << b.line << ": bad word " << letter;
+				d.Error = e.str();
+				return in;
+			}
+			if (letter == 'G'){
+				if (value == 0 or value == 1 or value == 2 or value == 3)
+					motion = (int) value;
+				else if (value == 90)
+					relative = false;
+				else if (value == 91)
+					relative = true;
+				else{
+					ostringstream e;
+					e << "line " << b.line << ": unsupported G" << value;
+					d.Error = e.str();
+					return in;
+				}
+			}else if (letter == 'M')
+				mcode = (int) value;
+			else if (letter == 'P')
+				device = (long) value;
+			else if (letter == 'F')
+				feed = value;
+			else if (letter == 'I' or letter == 'J'){
+				offset[letter - 'I'] = value;
+				moved = true;
+			}
+			else if (letter >= 'A' and letter <= 'Z' and axis[letter - 'A'] >= 0){
+				int i = axis[letter - 'A'];
+				long steps = (long) floor(value * scale[letter - 'A'] + 0.5);
+				b.target[i] = relative ? b.target[i] + steps : steps;
+				moved = true;
+			}else{
+				ostringstream e;
+				e << "line " << b.line << ": unknown word " << letter;
+				d.Error = e.str();
+				return in;
+			}
+		}
+		if (moved and motion >= 2){
+			if (x < 0 or y < 0){
+				ostringstream e;
+				e << "line " << b.line << ": arc without X and Y axes";
+				d.Error = e.str();
+				return in;
+			}
+			b.type = Block::Arc;
+			b.center[0] = (long double) d.pos[x] / m.steppers[x].getSteps() + offset[0];
+			b.center[1] = (long double) d.pos[y] / m.steppers[y].getSteps() + offset[1];
+			b.clockwise = motion == 2;
+		}
+		if (moved){
+			b.feed = motion ? feed : 0;
+			for(int i = 0; i < d.pos.size(); i++)
+				d.pos[i] = b.target[i];
+			simplifier.push(b);
+		}
+		if (mcode == 62 or mcode == 63){
+			if (device < 0 or device >= (long) m.onoffs.size()){
+				ostringstream e;
+				e << "line " << b.line << ": no on/off device " << device;
+				d.Error = e.str();
+				return in;
+			}
+			b.type = Block::Switch;
+			b.device = device;
+			b.state = mcode == 62;
+			simplifier.push(b);
+		}
+	}
+	simplifier.flush();
+	return in;
+}
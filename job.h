@@ -0,0 +1,39 @@
+#ifndef ___JOB_H__
+#define ___JOB_H__
+#include "cnc.h"
+#include "gcode.h"
+#include <iostream>
+#include <string>
+#include <deque>
+#include <vector>
+
+struct Block{
+	enum Type {Move, Switch, Arc};
+	Type type;
+	long target[AXES_MAX];
+	long double feed;
+	long double center[2];
+	bool clockwise;
+	unsigned device;
+	bool state;
+	unsigned long line;
+};
+
+class Job{
+protected:
+	Machine * _machine;
+public:
+	std::string Name;
+	std::string Error;
+	std::vector<long> pos;
+	std::deque<Block> blocks;
+	int client;
+	unsigned long epoch;
+	Job(Machine * machine, bool fromMachine = true);
+	Machine * getMachine();
+	bool Load();
+	void Execute(const Block & b);
+	friend Gcode& operator >> (Gcode & in, Job & d);
+};
+
+#endif
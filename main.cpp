@@ -1,15 +1,52 @@
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <vector>
 #include "ParallelPort.h"
 #include "cnc.h"
+#include "job.h"
+#include "daemon.h"
 
 using namespace std;
 
+// cnc [-s] [-t trace] [-d | job...]
+//	-d	run as daemon
+//	-s	use a simulated port; jobs are run here instead of submitted
+//	-t	record port writes to trace
 int main (int argc, char * argv[]){
+	bool daemon = false, simulate = false;
+	string tracefile;
+	vector<string> jobs;
+	for(int i = 1; i < argc; i++)
+		if (!strcmp(argv[i], "-d"))
+			daemon = true;
+		else if (!strcmp(argv[i], "-s"))
+			simulate = true;
+		else if (!strcmp(argv[i], "-t") and i + 1 < argc)
+			tracefile = argv[++i];
+		else
+			jobs.push_back(argv[i]);
+
+	if (jobs.size() and !simulate and !daemon){
+		vector<int> fds;
+		for(int i = 0; i < jobs.size(); i++){
+			fds.push_back(Submit(jobs[i]));
+			if (fds.back() < 0)
+				cerr << "Cannot submit " << jobs[i] << endl;
+		}
+		for(int i = 0; i < fds.size(); i++)
+			if (fds[i] >= 0){
+				cout << jobs[i] << ':' << endl;
+				Follow(fds[i], cout);
+			}
+		return 0;
+	}
+
 	string conffile = "conf";
 	ifstream infile(conffile.c_str());
 
-	string portname = "/dev/parport0";
+	string portname = simulate ? "simulated" : "/dev/parport0";
+	ofstream trace;
 	ParallelPort IOPort;
 
 	Machine m;
@@ -18,10 +55,35 @@ int main (int argc, char * argv[]){
 	infile >> m;
 	infile.close();
 
+	if (tracefile.length()){
+		trace.open(tracefile.c_str());
+		IOPort.Trace(&trace);
+	}
+
 	try{
-		IOPort.Open(portname);
+		if (simulate)
+			IOPort.Simulate(portname);
+		else
+			IOPort.Open(portname);
 		cout << m;
 		m.Zero();
+		if (daemon){
+			Daemon(&m).Run();
+			return 0;
+		}
+		if (jobs.size()){
+			for(int i = 0; i < jobs.size(); i++){
+				Job job(&m);
+				job.Name = jobs[i];
+				if (!job.Load()){
+					cerr << jobs[i] << ": " << job.Error << endl;
+					return 1;
+				}
+				for(int b = 0; b < job.blocks.size(); b++)
+					job.Execute(job.blocks[b]);
+			}
+			return 0;
+		}
 		for(int i = 0; i < m.steppers.size(); i++)
 			m.steppers[i].Step(-4);
 		for(int i = 0; i < m.onoffs.size(); i++)
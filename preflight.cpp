@@ -0,0 +1,280 @@
+#include "preflight.h"
+#include <cmath>
+#include <sstream>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+static const size_t stride = PREFLIGHT_CHUNK + 1;
+static const size_t passed = (size_t) -1;
+
+Preflight::Chunk::Chunk(int axes)
+		: lo(axes * stride), hi(axes * stride), travel(axes * stride), velocity(axes * stride), bend(axes * stride), time(stride){
+}
+Preflight::Preflight(Machine * machine, const vector<long> & start, const deque<Block> & blocks){
+	_machine = machine;
+	_blocks = &blocks;
+	_start = start;
+	_count = blocks.size();
+	_x = machine->Axis('X');
+	_y = machine->Axis('Y');
+	for(int i = 0; i < machine->steppers.size(); i++){
+		Stepper & s = machine->steppers[i];
+		_min.push_back(s.getMin());
+		_max.push_back(s.getMax());
+		_maxSpeed.push_back(s.getMaxSpeed() > 0 ? (double) s.getMaxSpeed() : HUGE_VAL);
+		_accel.push_back(s.getAccel() > 0 ? (double) s.getAccel() : HUGE_VAL);
+		_scale.push_back(1.0 / s.getSteps());
+		_delay.push_back(s.getDelay());
+		_backlash.push_back(s.getBacklash());
+	}
+	turns(machine);
+}
+static int sign(double v){
+	return v < 0 ? -1 : v > 0 ? 1 : 0;
+}
+// Marks the axes each block starts by reversing, and so taking up backlash.
+// That depends on the last direction moved however far back, so it is one
+// sequential pass ahead of the parallel checks. On an arc X and Y start and
+// end along the tangent, or away from and into an extreme they sit on.
+void Preflight::turns(Machine * machine){
+	int n = _min.size(), x = _x, y = _y;
+	vector<int> last(n);
+	for(int i = 0; i < n; i++)
+		last[i] = machine->steppers[i].getDir();
+	_turns.assign(_count, 0);
+	for(size_t k = 0; k < _count; k++){
+		const Block & b = (*_blocks)[k];
+		if (b.type == Block::Switch)
+			continue;
+		const long * from = k ? (*_blocks)[k - 1].target : &_start[0];
+		for(int i = 0; i < n; i++){
+			int begin = sign(b.target[i] - from[i]), end = begin;
+			if (b.type == Block::Arc and (i == x or i == y)){
+				int j = i == x ? 0 : 1, turn = (i == x) == b.clockwise ? 1 : -1;
+				double a[2] = {from[x] * _scale[x] - b.center[0], from[y] * _scale[y] - b.center[1]};
+				double e[2] = {b.target[x] * _scale[x] - b.center[0], b.target[y] * _scale[y] - b.center[1]};
+				begin = sign(turn * a[1 - j]);
+				end = sign(turn * e[1 - j]);
+				if (!begin)
+					begin = -sign(a[j]);
+				if (!end)
+					end = sign(e[j]);
+			}
+			if (begin and begin != last[i])
+				_turns[k] |= 1 << i;
+			if (end)
+				last[i] = end;
+		}
+	}
+}
+// Fills slots 0 to count - 1 with indices first onwards. Index k holds
+// block k - 1; index 0 and _count + 1 are the machine at rest before and
+// after the job, as are on/off switches.
+void Preflight::build(Chunk & c, size_t first, size_t count){
+	int n = _min.size(), x = _x, y = _y;
+	for(size_t slot = 0; slot < count; slot++){
+		size_t k = first + slot;
+		if (k == 0 or k > _count or (*_blocks)[k - 1].type == Block::Switch){
+			for(int i = 0; i < n; i++){
+				c.lo[i * stride + slot] = c.hi[i * stride + slot] = NAN;
+				c.travel[i * stride + slot] = c.velocity[i * stride + slot] = c.bend[i * stride + slot] = 0;
+			}
+			c.time[slot] = 0;
+			continue;
+		}
+		const Block & b = (*_blocks)[k - 1];
+		const long * from = k > 1 ? (*_blocks)[k - 2].target : &_start[0];
+		double length = 0, rapid = 0, r = 0, along[2] = {0, 0}, across[2] = {0, 0};
+		int inside[2] = {0, 0};
+		for(int i = 0; i < n; i++){
+			double a = from[i] * _scale[i], e = b.target[i] * _scale[i];
+			double steps = labs(b.target[i] - from[i]) + (_turns[k - 1] >> i & 1) * _backlash[i];
+			c.bend[i * stride + slot] = 0;
+			c.lo[i * stride + slot] = a < e ? a : e;
+			c.hi[i * stride + slot] = a < e ? e : a;
+			c.travel[i * stride + slot] = fabs(e - a);
+			length += (e - a) * (e - a);
+			if (steps * _delay[i] > rapid)
+				rapid = steps * _delay[i];
+		}
+		if (b.type == Block::Arc){
+			double ax = from[x] * _scale[x] - b.center[0], ay = from[y] * _scale[y] - b.center[1];
+			double bx = b.target[x] * _scale[x] - b.center[0], by = b.target[y] * _scale[y] - b.center[1];
+			double r0 = sqrt(ax * ax + ay * ay), r1 = sqrt(bx * bx + by * by);
+			r = r0 > r1 ? r0 : r1;
+			double a0 = atan2(ay, ax), sweep = atan2(by, bx) - a0;
+			if (b.clockwise and sweep >= 0)
+				sweep -= 2 * M_PI;
+			else if (!b.clockwise and sweep <= 0)
+				sweep += 2 * M_PI;
+			// Share of the tangential speed and of the centripetal acceleration
+			// each axis sees at worst: all of it where the arc runs along or
+			// across that axis, else the most at either end.
+			if (r > 0){
+				along[0] = (fabs(ay) > fabs(by) ? fabs(ay) : fabs(by)) / r;
+				along[1] = across[0] = (fabs(ax) > fabs(bx) ? fabs(ax) : fabs(bx)) / r;
+				across[1] = along[0];
+			}
+			for(int q = 0; q < 4; q++){
+				double ahead = fmod((b.clockwise ? a0 - q * M_PI_2 : q * M_PI_2 - a0) + 4 * M_PI, 2 * M_PI);
+				if (ahead > fabs(sweep))
+					continue;
+				along[1 - q % 2] = across[q % 2] = 1;
+				if (ahead > 0 and ahead < fabs(sweep))
+					inside[q % 2]++;
+				size_t at = (q % 2 ? y : x) * stride + slot;
+				double extreme = b.center[q % 2] + (q < 2 ? r : -r);
+				if (extreme < c.lo[at])
+					c.lo[at] = extreme;
+				if (extreme > c.hi[at])
+					c.hi[at] = extreme;
+			}
+			double planar = c.travel[x * stride + slot] * c.travel[x * stride + slot] + c.travel[y * stride + slot] * c.travel[y * stride + slot];
+			length += r * r * sweep * sweep - planar;
+			c.travel[x * stride + slot] = r * fabs(sweep) * along[0] + inside[0] * _backlash[x] * _scale[x];
+			c.travel[y * stride + slot] = r * fabs(sweep) * along[1] + inside[1] * _backlash[y] * _scale[y];
+		}
+		// Backlash is taken up within the move, on top of its travel
+		for(int i = 0; i < n; i++)
+			c.travel[i * stride + slot] += (_turns[k - 1] >> i & 1) * _backlash[i] * _scale[i];
+		double time = b.feed > 0 ? sqrt(length) / (double) b.feed : rapid / minute;
+		c.time[slot] = time;
+		for(int i = 0; i < n; i++)
+			c.velocity[i * stride + slot] = time > 0 ? (b.target[i] - from[i]) * _scale[i] / time : 0;
+		if (b.type == Block::Arc and r > 0 and time > 0){
+			double centripetal = length / (time * time * r);
+			c.bend[x * stride + slot] = centripetal * across[0];
+			c.bend[y * stride + slot] = centripetal * across[1];
+		}
+	}
+}
+// Nonzero if any index in [k, last) of one axis breaks a limit. NaN bounds
+// and unchecked limits compare false. A change of speed between blocks may
+// take half of each.
+static int violations(const double * lo, const double * hi, const double * travel, const double * v, const double * bend,
+		const double * t, double min, double max, double speed, double accel, size_t k, size_t last){
+	int bad = 0;
+#if defined(__AVX__)
+	const __m256d vmin = _mm256_set1_pd(min), vmax = _mm256_set1_pd(max), vspeed = _mm256_set1_pd(speed);
+	const __m256d vaccel = _mm256_set1_pd(accel), vhalf = _mm256_set1_pd(accel / 2), sign = _mm256_set1_pd(-0.0);
+	for(; last - k >= 4; k += 4){
+		__m256d time = _mm256_loadu_pd(t + k), before = _mm256_loadu_pd(t + k - 1);
+		__m256d change = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(v + k), _mm256_loadu_pd(v + k - 1)));
+		__m256d fail = _mm256_or_pd(
+			_mm256_or_pd(_mm256_cmp_pd(_mm256_loadu_pd(lo + k), vmin, _CMP_LT_OQ), _mm256_cmp_pd(_mm256_loadu_pd(hi + k), vmax, _CMP_GT_OQ)),
+			_mm256_or_pd(_mm256_cmp_pd(_mm256_loadu_pd(travel + k), _mm256_mul_pd(vspeed, time), _CMP_GT_OQ),
+				_mm256_or_pd(_mm256_cmp_pd(change, _mm256_mul_pd(vhalf, _mm256_add_pd(time, before)), _CMP_GT_OQ),
+					_mm256_cmp_pd(_mm256_loadu_pd(bend + k), vaccel, _CMP_GT_OQ))));
+		bad |= _mm256_movemask_pd(fail);
+	}
+#elif defined(__SSE2__)
+	const __m128d vmin = _mm_set1_pd(min), vmax = _mm_set1_pd(max), vspeed = _mm_set1_pd(speed);
+	const __m128d vaccel = _mm_set1_pd(accel), vhalf = _mm_set1_pd(accel / 2), sign = _mm_set1_pd(-0.0);
+	for(; last - k >= 2; k += 2){
+		__m128d time = _mm_loadu_pd(t + k), before = _mm_loadu_pd(t + k - 1);
+		__m128d change = _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(v + k), _mm_loadu_pd(v + k - 1)));
+		__m128d fail = _mm_or_pd(
+			_mm_or_pd(_mm_cmplt_pd(_mm_loadu_pd(lo + k), vmin), _mm_cmpgt_pd(_mm_loadu_pd(hi + k), vmax)),
+			_mm_or_pd(_mm_cmpgt_pd(_mm_loadu_pd(travel + k), _mm_mul_pd(vspeed, time)),
+				_mm_or_pd(_mm_cmpgt_pd(change, _mm_mul_pd(vhalf, _mm_add_pd(time, before))),
+					_mm_cmpgt_pd(_mm_loadu_pd(bend + k), vaccel))));
+		bad |= _mm_movemask_pd(fail);
+	}
+#endif
+	for(; k < last; k++)
+		bad |= (lo[k] < min) | (hi[k] > max) | (travel[k] > speed * t[k])
+			| (fabs(v[k] - v[k - 1]) > accel / 2 * (t[k] + t[k - 1])) | (bend[k] > accel);
+	return bad;
+}
+
+// First failing index in [begin, end), or passed
+size_t Preflight::check(size_t begin, size_t end){
+	int n = _min.size();
+	Chunk c(n);
+	for(size_t chunk = begin; chunk < end; chunk += PREFLIGHT_CHUNK){
+		size_t count = chunk + PREFLIGHT_CHUNK < end ? PREFLIGHT_CHUNK : end - chunk;
+		int bad = 0;
+		build(c, chunk - 1, count + 1);
+		for(int i = 0; i < n; i++)
+			bad |= violations(&c.lo[i * stride], &c.hi[i * stride], &c.travel[i * stride], &c.velocity[i * stride], &c.bend[i * stride],
+				&c.time[0], _min[i], _max[i], _maxSpeed[i], _accel[i], 1, count + 1);
+		if (!bad)
+			continue;
+		for(size_t slot = 1; slot <= count; slot++)
+			if (explain(c, slot, chunk + slot - 1).length())
+				return chunk + slot - 1;
+	}
+	return passed;
+}
+string Preflight::explain(Chunk & c, size_t slot, size_t k){
+	int n = _min.size();
+	ostringstream e;
+	if (k <= _count)
+		e << "line " << (*_blocks)[k - 1].line << ": ";
+	else
+		e << "end of job: ";
+	for(int i = 0; i < n; i++){
+		size_t at = i * stride + slot;
+		const string & name = _machine->steppers[i].Name;
+		double change = fabs(c.velocity[at] - c.velocity[at - 1]);
+		if (c.lo[at] < _min[i] or c.hi[at] > _max[i]){
+			e << name << " travels " << c.lo[at] << " to " << c.hi[at] << " outside " << _min[i] << " to " << _max[i];
+			return e.str();
+		}
+		if (c.travel[at] > _maxSpeed[i] * c.time[slot]){
+			e << name << " moves at " << c.travel[at] / c.time[slot] << " over maximum speed " << _maxSpeed[i];
+			return e.str();
+		}
+		if (change > _accel[i] / 2 * (c.time[slot] + c.time[slot - 1])){
+			e << name << " changes speed by " << change << " faster than acceleration " << _accel[i] << " allows";
+			return e.str();
+		}
+		if (c.bend[at] > _accel[i]){
+			e << name << " needs " << c.bend[at] << " to follow the arc, over acceleration " << _accel[i];
+			return e.str();
+		}
+	}
+	return "";
+}
+void * Preflight::worker(void * r){
+	Range & range = *(Range *) r;
+	range.failed = range.preflight->check(range.begin, range.end);
+	return NULL;
+}
+bool Preflight::Run(){
+	long threads = 1;
+	if (_count > 16 * PREFLIGHT_CHUNK)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+		threads = 1;
+	vector<Range> ranges(threads);
+	vector<pthread_t> ids(threads);
+	size_t total = _count + 1, share = (total + threads - 1) / threads, failed = passed;
+	for(long t = 0; t < threads; t++){
+		ranges[t].preflight = this;
+		ranges[t].begin = 1 + t * share < 1 + total ? 1 + t * share : 1 + total;
+		ranges[t].end = ranges[t].begin + share < 1 + total ? ranges[t].begin + share : 1 + total;
+		ranges[t].failed = passed;
+		if (t)
+			pthread_create(&ids[t], NULL, worker, &ranges[t]);
+	}
+	worker(&ranges[0]);
+	for(long t = 1; t < threads; t++)
+		pthread_join(ids[t], NULL);
+	for(long t = 0; t < threads; t++)
+		if (ranges[t].failed < failed)
+			failed = ranges[t].failed;
+	if (failed == passed)
+		return true;
+	Chunk c(_min.size());
+	build(c, failed - 1, 2);
+	Error = explain(c, 1, failed);
+	return false;
+}
@@ -0,0 +1,44 @@
+#ifndef ___PREFLIGHT_H__
+#define ___PREFLIGHT_H__
+#include "cnc.h"
+#include "job.h"
+#include <string>
+#include <deque>
+#include <vector>
+
+#define PREFLIGHT_CHUNK 4096
+
+// Checks a whole job against each axis' travel, maximum speed and
+// acceleration before anything moves. Blocks are laid out a chunk at a
+// time as one contiguous array per axis so the checks vectorize, and large
+// jobs are split across threads.
+class Preflight{
+protected:
+	struct Chunk{
+		std::vector<double> lo, hi, travel, velocity, bend, time;
+		Chunk(int axes);
+	};
+	struct Range{
+		Preflight * preflight;
+		size_t begin, end, failed;
+	};
+	Machine * _machine;
+	const std::deque<Block> * _blocks;
+	std::vector<long> _start;
+	size_t _count;
+	int _x, _y;
+	std::vector<double> _min, _max, _maxSpeed, _accel;
+	std::vector<double> _scale, _delay, _backlash;
+	std::vector<unsigned char> _turns;
+	void turns(Machine * machine);
+	void build(Chunk & c, size_t first, size_t count);
+	size_t check(size_t begin, size_t end);
+	std::string explain(Chunk & c, size_t slot, size_t k);
+	static void * worker(void * r);
+public:
+	std::string Error;
+	Preflight(Machine * machine, const std::vector<long> & start, const std::deque<Block> & blocks);
+	bool Run();
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "simplify.h"
+#include <cmath>
+
+using namespace std;
+
+Simplifier::Simplifier(Machine * machine, deque<Block> * out, const vector<long> & start){
+	_machine = machine;
+	_out = out;
+	_start = start;
+	_x = machine->Axis('X');
+	_y = machine->Axis('Y');
+	_verified = 0;
+}
+long double Simplifier::unit(const long * p, int i){
+	return (long double) p[i] / _machine->steppers[i].getSteps();
+}
+void Simplifier::push(const Block & b){
+	if (_machine->Tolerance <= 0 or b.type != Block::Move){
+		flush();
+		_out->push_back(b);
+		_start.assign(b.target, b.target + _start.size());
+		return;
+	}
+	if (!_window.empty() and (b.feed != _window.back().feed or _window.size() >= SIMPLIFY_WINDOW))
+		flush();
+	_window.push_back(b);
+	if (_window.size() == 1){
+		_fit = _good = b;
+		_verified = 1;
+		return;
+	}
+	if (_window.size() > 2 and (_fit.type == Block::Arc ? onArc(b.target) : onLine(b.target))){
+		for(int i = 0; i < AXES_MAX; i++)
+			_fit.target[i] = b.target[i];
+		if (_window.size() < 2 * _verified or refit())
+			return;
+	}else if (refit())
+		return;
+	retreat();
+}
+void Simplifier::flush(){
+	if (_window.empty())
+		return;
+	if (_verified < _window.size() and !refit()){
+		retreat();
+		flush();
+		return;
+	}
+	_out->push_back(_fit);
+	_start.assign(_fit.target, _fit.target + _start.size());
+	_window.clear();
+}
+// Fits the whole window, keeping the fit as the last known good one
+bool Simplifier::refit(){
+	Block fit = _window.back();
+	fit.line = _window.front().line;
+	if (!line(fit) and !arc(fit))
+		return false;
+	_fit = _good = fit;
+	_verified = _window.size();
+	return true;
+}
+// Writes the longest fit that holds, halving the moves between the last
+// good fit and the window end, and pushes the moves after it again
+void Simplifier::retreat(){
+	deque<Block> all(_window);
+	for(size_t bad = all.size(); bad - _verified > 1;){
+		size_t middle = (_verified + bad) / 2;
+		_window.assign(all.begin(), all.begin() + middle);
+		if (!refit())
+			bad = middle;
+	}
+	size_t done = _verified;
+	_window.assign(all.begin(), all.begin() + done);
+	_fit = _good;
+	flush();
+	for(size_t j = done; j < all.size(); j++)
+		push(all[j]);
+}
+// Fits the line from the window start to its end
+bool Simplifier::line(Block & fit){
+	int n = _start.size(), k = _window.size();
+	const long * start = &_start[0], * end = _window.back().target;
+	long double length = 0;
+	_dir.resize(n);
+	for(int i = 0; i < n; i++){
+		_dir[i] = unit(end, i) - unit(start, i);
+		length += _dir[i] * _dir[i];
+	}
+	if (length == 0)
+		return false;
+	length = sqrtl(length);
+	for(int i = 0; i < n; i++)
+		_dir[i] /= length;
+	_along = 0;
+	for(int j = 0; j < k; j++)
+		if (!onLine(_window[j].target))
+			return false;
+	fit.type = Block::Move;
+	return true;
+}
+// The point must lie within tolerance of the line, further along it than
+// the one before.
+bool Simplifier::onLine(const long * p){
+	long double along = 0, distance = 0, tolerance = _machine->Tolerance;
+	for(int i = 0; i < (int) _dir.size(); i++){
+		long double d = unit(p, i) - unit(&_start[0], i);
+		along += d * _dir[i];
+		distance += d * d;
+	}
+	if (along <= _along or distance - along * along > tolerance * tolerance)
+		return false;
+	_along = along;
+	return true;
+}
+// Fits a circle through the window start and end in the XY plane, centred
+// as near the candidate circle as there is one, else through the middle
+// point too
+bool Simplifier::arc(Block & fit){
+	int k = _window.size();
+	if (_x < 0 or _y < 0 or k < 3)
+		return false;
+	const long * start = &_start[0], * middle = _window[k / 2 - 1].target, * end = _window.back().target;
+	long double ax = unit(start, _x), ay = unit(start, _y);
+	long double bx = unit(middle, _x), by = unit(middle, _y);
+	long double cx = unit(end, _x), cy = unit(end, _y);
+	if (_fit.type == Block::Arc){
+		long double mx = (ax + cx) / 2, my = (ay + cy) / 2, nx = ay - cy, ny = cx - ax, n2 = nx * nx + ny * ny;
+		if (n2 > 0){
+			long double t = ((_cx - mx) * nx + (_cy - my) * ny) / n2;
+			if (around(mx + t * nx, my + t * ny, fit))
+				return true;
+		}
+	}
+	long double d = 2 * (ax * (by - cy) + bx * (cy - ay) + cx * (ay - by));
+	if (fabsl(d) < 1e-12)
+		return false;
+	long double a2 = ax * ax + ay * ay, b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+	return around((a2 * (by - cy) + b2 * (cy - ay) + c2 * (ay - by)) / d,
+		(a2 * (cx - bx) + b2 * (ax - cx) + c2 * (bx - ax)) / d, fit);
+}
+// Checks the window against the circle through its start around (cx, cy)
+bool Simplifier::around(long double cx, long double cy, Block & fit){
+	_cx = cx;
+	_cy = cy;
+	_px = unit(&_start[0], _x) - cx;
+	_py = unit(&_start[0], _y) - cy;
+	_r = sqrtl(_px * _px + _py * _py);
+	_sweep = 0;
+	for(int j = 0; j < (int) _window.size(); j++)
+		if (!onArc(_window[j].target))
+			return false;
+	fit.type = Block::Arc;
+	fit.center[0] = cx;
+	fit.center[1] = cy;
+	fit.clockwise = _sweep < 0;
+	return true;
+}
+// Checks the point, the midpoint of the chord to it and the sagitta of the
+// arc over that chord, turning the same way as before and short of a full
+// circle. Other axes must not move.
+bool Simplifier::onArc(const long * p){
+	for(int i = 0; i < (int) _start.size(); i++)
+		if (i != _x and i != _y and p[i] != _start[i])
+			return false;
+	long double tolerance = _machine->Tolerance;
+	long double qx = unit(p, _x) - _cx, qy = unit(p, _y) - _cy;
+	long double mx = (_px + qx) / 2, my = (_py + qy) / 2;
+	long double step = atan2l(_px * qy - _py * qx, _px * qx + _py * qy);
+	if (fabsl(sqrtl(qx * qx + qy * qy) - _r) > tolerance
+			or fabsl(sqrtl(mx * mx + my * my) - _r) > tolerance
+			or _r * (1 - cosl(step / 2)) > tolerance
+			or step == 0 or (_sweep != 0 and (step > 0) != (_sweep > 0))
+			or fabsl(_sweep + step) >= 2 * M_PI)
+		return false;
+	_sweep += step;
+	_px = qx;
+	_py = qy;
+	return true;
+}
@@ -0,0 +1,42 @@
+#ifndef ___SIMPLIFY_H__
+#define ___SIMPLIFY_H__
+#include "cnc.h"
+#include "job.h"
+#include <deque>
+#include <vector>
+
+#define SIMPLIFY_WINDOW 256
+
+// Replaces runs of short moves with one line or one XY arc when every
+// original point stays within the machine's path tolerance. Holds at most
+// SIMPLIFY_WINDOW moves at a time. Once a line or circle fits, each further
+// move is checked against it alone. The whole window is fitted again only
+// when that fails, when the window has doubled since its last full fit, and
+// before it is written; should that fit fail, the last one that held is
+// written and the moves after it go through again.
+class Simplifier{
+protected:
+	Machine * _machine;
+	std::deque<Block> * _out;
+	std::vector<long> _start;
+	std::deque<Block> _window;
+	Block _fit, _good;
+	size_t _verified;
+	int _x, _y;
+	std::vector<long double> _dir;
+	long double _along, _cx, _cy, _r, _px, _py, _sweep;
+	long double unit(const long * p, int i);
+	bool line(Block & fit);
+	bool arc(Block & fit);
+	bool around(long double cx, long double cy, Block & fit);
+	bool onLine(const long * p);
+	bool onArc(const long * p);
+	bool refit();
+	void retreat();
+public:
+	Simplifier(Machine * machine, std::deque<Block> * out, const std::vector<long> & start);
+	void push(const Block & b);
+	void flush();
+};
+
+#endif
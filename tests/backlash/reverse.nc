@@ -0,0 +1,4 @@
+G1 F600 X2 Y1
+X0.5 Y0.25
+X3 Y1.5
+G0 X0 Y0
@@ -0,0 +1,2 @@
+G1 F100
+X. ; long enough for the fast path
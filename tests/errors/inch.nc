@@ -0,0 +1,2 @@
+G20
+G1 F100 X1
@@ -0,0 +1,2 @@
+G1 F100 X1
+G18 G2 X0 Z1 I-0.5
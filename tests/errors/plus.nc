@@ -0,0 +1 @@
+G1 F100 X+ ; long enough for the fast path
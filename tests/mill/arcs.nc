@@ -0,0 +1,5 @@
+G1 F300 X1 Y0
+G3 X0 Y1 I-1 J0
+G2 X-1 Y0 I0 J-1
+G3 X1 Y0 I1 J0
+G0 X0 Y0
@@ -0,0 +1,4 @@
+G1 F100 X1 Y0.5
+(unterminated
+X0.5 Y0.25
+X1 Y1 (fine) Y0.5
@@ -0,0 +1,10 @@
+%
+(lines, rapids and the spindle)
+G90 G1 F600 X1 Y0.5
+M62 P0
+X2.5 Y-0.25 ; diagonal
+G91 X-0.5 Y1
+G90
+M63 P0
+G0 X0 Y0
+%
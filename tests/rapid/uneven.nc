@@ -0,0 +1 @@
+G0 X10
@@ -0,0 +1,3 @@
+G1 F600 X0.05
+X0.5 Y0.1
+X0
@@ -0,0 +1,122 @@
+G1 F1200
+X1.5000 Y0.0000
+X1.4979 Y0.0785
+X1.4918 Y0.1568
+X1.4815 Y0.2347
+X1.4672 Y0.3119
+X1.4489 Y0.3882
+X1.4266 Y0.4635
+X1.4004 Y0.5376
+X1.3703 Y0.6101
+X1.3365 Y0.6810
+X1.2990 Y0.7500
+X1.2580 Y0.8170
+X1.2135 Y0.8817
+X1.1657 Y0.9440
+X1.1147 Y1.0037
+X1.0607 Y1.0607
+X1.0037 Y1.1147
+X0.9440 Y1.1657
+X0.8817 Y1.2135
+X0.8170 Y1.2580
+X0.7500 Y1.2990
+X0.6810 Y1.3365
+X0.6101 Y1.3703
+X0.5376 Y1.4004
+X0.4635 Y1.4266
+X0.3882 Y1.4489
+X0.3119 Y1.4672
+X0.2347 Y1.4815
+X0.1568 Y1.4918
+X0.0785 Y1.4979
+X0.0000 Y1.5000
+X-0.0785 Y1.4979
+X-0.1568 Y1.4918
+X-0.2347 Y1.4815
+X-0.3119 Y1.4672
+X-0.3882 Y1.4489
+X-0.4635 Y1.4266
+X-0.5376 Y1.4004
+X-0.6101 Y1.3703
+X-0.6810 Y1.3365
+X-0.7500 Y1.2990
+X-0.8170 Y1.2580
+X-0.8817 Y1.2135
+X-0.9440 Y1.1657
+X-1.0037 Y1.1147
+X-1.0607 Y1.0607
+X-1.1147 Y1.0037
+X-1.1657 Y0.9440
+X-1.2135 Y0.8817
+X-1.2580 Y0.8170
+X-1.2990 Y0.7500
+X-1.3365 Y0.6810
+X-1.3703 Y0.6101
+X-1.4004 Y0.5376
+X-1.4266 Y0.4635
+X-1.4489 Y0.3882
+X-1.4672 Y0.3119
+X-1.4815 Y0.2347
+X-1.4918 Y0.1568
+X-1.4979 Y0.0785
+X-1.5000 Y0.0000
+X-1.4979 Y-0.0785
+X-1.4918 Y-0.1568
+X-1.4815 Y-0.2347
+X-1.4672 Y-0.3119
+X-1.4489 Y-0.3882
+X-1.4266 Y-0.4635
+X-1.4004 Y-0.5376
+X-1.3703 Y-0.6101
+X-1.3365 Y-0.6810
+X-1.2990 Y-0.7500
+X-1.2580 Y-0.8170
+X-1.2135 Y-0.8817
+X-1.1657 Y-0.9440
+X-1.1147 Y-1.0037
+X-1.0607 Y-1.0607
+X-1.0037 Y-1.1147
+X-0.9440 Y-1.1657
+X-0.8817 Y-1.2135
+X-0.8170 Y-1.2580
+X-0.7500 Y-1.2990
+X-0.6810 Y-1.3365
+X-0.6101 Y-1.3703
+X-0.5376 Y-1.4004
+X-0.4635 Y-1.4266
+X-0.3882 Y-1.4489
+X-0.3119 Y-1.4672
+X-0.2347 Y-1.4815
+X-0.1568 Y-1.4918
+X-0.0785 Y-1.4979
+X-0.0000 Y-1.5000
+X0.0200 Y1.4900
+X0.0400 Y1.4800
+X0.0600 Y1.4700
+X0.0800 Y1.4600
+X0.1000 Y1.4500
+X0.1200 Y1.4400
+X0.1400 Y1.4300
+X0.1600 Y1.4200
+X0.1800 Y1.4100
+X0.2000 Y1.4000
+X0.2200 Y1.3900
+X0.2400 Y1.3800
+X0.2600 Y1.3700
+X0.2800 Y1.3600
+X0.3000 Y1.3500
+X0.3200 Y1.3400
+X0.3400 Y1.3300
+X0.3600 Y1.3200
+X0.3800 Y1.3100
+X0.4000 Y1.3000
+X0.4200 Y1.2900
+X0.4400 Y1.2800
+X0.4600 Y1.2700
+X0.4800 Y1.2600
+X0.5000 Y1.2500
+X0.5200 Y1.2400
+X0.5400 Y1.2300
+X0.5600 Y1.2200
+X0.5800 Y1.2100
+X0.6000 Y1.2000
@@ -0,0 +1,4 @@
+G0 X1
+G0 X0
+G1 F90 X0.1
+X0
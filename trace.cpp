@@ -0,0 +1,86 @@
+#include "trace.h"
+
+using namespace std;
+
+istream& operator >> (istream & in, PortWrite & w){
+	unsigned value;
+	in >> w.time >> w.reg >> hex >> value >> dec;
+	w.value = value;
+	return in;
+}
+istream& operator >> (istream & in, deque<PortWrite> & trace){
+	PortWrite w;
+	while (in >> w)
+		trace.push_back(w);
+	return in;
+}
+
+TraceDiff::TraceDiff(unsigned long long tolerance){
+	Tolerance = tolerance;
+	_golden = _traced = _differ = _late = 0;
+	_first = (unsigned long) -1;
+	_deviation = 0;
+}
+void TraceDiff::Channels(Machine & m){
+	Channel c;
+	c.differ = c.late = 0;
+	c.deviation = 0;
+	for(int i = 0; i < m.steppers.size(); i++){
+		c.name = m.steppers[i].Name;
+		c.mask = m.steppers[i].Mask();
+		_channels.push_back(c);
+	}
+	for(int i = 0; i < m.onoffs.size(); i++){
+		c.name = m.onoffs[i].Name;
+		c.mask = m.onoffs[i].Mask();
+		_channels.push_back(c);
+	}
+}
+bool TraceDiff::Compare(const deque<PortWrite> & golden, const deque<PortWrite> & traced){
+	unsigned char last = 0;
+	_golden = golden.size();
+	_traced = traced.size();
+	for(unsigned long i = 0; i < _golden and i < _traced; i++){
+		const PortWrite & a = golden[i], & b = traced[i];
+		unsigned long long deviation = a.time > b.time ? a.time - b.time : b.time - a.time;
+		bool differ = a.reg != b.reg or a.value != b.value;
+		if (differ){
+			_differ++;
+			if (_first > i)
+				_first = i;
+		}
+		if (deviation > Tolerance)
+			_late++;
+		if (deviation > _deviation)
+			_deviation = deviation;
+		if (a.reg != 'D')
+			continue;
+		for(int c = 0; c < _channels.size(); c++){
+			Channel & ch = _channels[c];
+			if (b.reg != 'D' or ((a.value ^ b.value) & ch.mask))
+				ch.differ++;
+			if ((a.value ^ last) & ch.mask){
+				if (deviation > Tolerance)
+					ch.late++;
+				if (deviation > ch.deviation)
+					ch.deviation = deviation;
+			}
+		}
+		last = a.value;
+	}
+	return _golden == _traced and !_differ and !_late;
+}
+ostream& operator << (ostream & outfile, TraceDiff & d){
+	outfile << "Writes: " << d._golden << " golden, " << d._traced << " traced" << endl;
+	if (d._differ)
+		outfile << "Bytes: " << d._differ << " differ, first at write " << d._first + 1 << endl;
+	else
+		outfile << "Bytes: identical" << (d._golden != d._traced ? " where both have writes" : "") << endl;
+	outfile << "Timing: " << d._late << " write" << (d._late != 1 ? "s" : "") << " off by more than "
+		<< d.Tolerance << " us, at most " << d._deviation << " us" << endl;
+	for(int c = 0; c < d._channels.size(); c++){
+		TraceDiff::Channel & ch = d._channels[c];
+		outfile << ch.name << ": " << ch.differ << " differ, " << ch.late << " late, at most " << ch.deviation << " us" << endl;
+	}
+	return outfile;
+}
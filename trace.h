@@ -0,0 +1,41 @@
+#ifndef ___TRACE_H__
+#define ___TRACE_H__
+#include "cnc.h"
+#include <iostream>
+#include <string>
+#include <deque>
+#include <vector>
+
+// One register write as recorded by ParallelPort::Trace
+struct PortWrite{
+	unsigned long long time;
+	char reg;
+	unsigned char value;
+};
+
+std::istream& operator >> (std::istream & in, PortWrite & w);
+std::istream& operator >> (std::istream & in, std::deque<PortWrite> & trace);
+
+// Compares a trace against a golden one write by write: exact register and
+// value, and time within Tolerance microseconds. Devices added with
+// Channels get their own summary over the data pins they own.
+class TraceDiff{
+protected:
+	struct Channel{
+		std::string name;
+		unsigned char mask;
+		unsigned long differ, late;
+		unsigned long long deviation;
+	};
+	std::vector<Channel> _channels;
+	unsigned long _golden, _traced, _differ, _late, _first;
+	unsigned long long _deviation;
+public:
+	unsigned long long Tolerance;
+	TraceDiff(unsigned long long tolerance = 0);
+	void Channels(Machine & m);
+	bool Compare(const std::deque<PortWrite> & golden, const std::deque<PortWrite> & traced);
+	friend std::ostream& operator << (std::ostream & outfile, TraceDiff & d);
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include "cnc.h"
+#include "trace.h"
+
+using namespace std;
+
+// tracediff [-t usec] [-c conf] golden traced
+// Exits with 0 when both traces match within the tolerance.
+int main (int argc, char * argv[]){
+	string conffile = "conf";
+	unsigned long long tolerance = 0;
+	vector<string> files;
+	for(int i = 1; i < argc; i++)
+		if (!strcmp(argv[i], "-t") and i + 1 < argc)
+			tolerance = strtoull(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-c") and i + 1 < argc)
+			conffile = argv[++i];
+		else
+			files.push_back(argv[i]);
+	if (files.size() != 2){
+		cerr << "Usage: " << argv[0] << " [-t usec] [-c conf] golden traced" << endl;
+		return 2;
+	}
+
+	deque<PortWrite> traces[2];
+	for(int i = 0; i < 2; i++){
+		ifstream infile(files[i].c_str());
+		if (!infile.is_open()){
+			cerr << "Cannot open " << files[i] << endl;
+			return 2;
+		}
+		infile >> traces[i];
+	}
+
+	TraceDiff diff(tolerance);
+	ifstream infile(conffile.c_str());
+	if (infile.is_open()){
+		Machine m;
+		infile >> m;
+		diff.Channels(m);
+	}
+	bool same = diff.Compare(traces[0], traces[1]);
+	cout << diff;
+	return same ? 0 : 1;
+}